@@ -7,15 +7,20 @@
 
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <queue>
+#include <utility>
 
 namespace cppbase {
 
 /**
  * @brief BlockingQueue
+ * @note  Once closed, the queue rejects new values and every waiting Pop returns, after the
+ *   values still queued have been drained.
  */
 template <typename T>
 class BlockingQueue
@@ -24,34 +29,58 @@ public:
     BlockingQueue() = default;
     ~BlockingQueue() = default;
 
-    void Push(const T& data)
+    /**
+     * @return false if the queue is closed
+     */
+    bool Push(const T& data) { return Emplace(data); }
+    bool Push(T&& data) { return Emplace(std::move(data)); }
+
+    template <typename... Args>
+    bool Emplace(Args&&... args)
     {
+        bool waiting = false;
         {
             std::lock_guard<std::mutex> lock(m_mutex);
-            m_queue.push(data);
+            if (m_closed)
+                return false;
+            m_queue.emplace(std::forward<Args>(args)...);
+            waiting = m_waiters > 0;
         }
-        m_signal.notify_one();
+        // skip the notification if no consumer is waiting
+        if (waiting)
+            m_signal.notify_one();
+        return true;
     }
 
-    void Pop(T& data)
+    /**
+     * @brief Wait for a value
+     * @return false if the queue is closed and empty
+     */
+    bool Pop(T& data)
     {
         std::unique_lock<std::mutex> lock(m_mutex);
-        while (m_queue.empty())
-            m_signal.wait(lock);
+        Wait(lock);
+        if (m_queue.empty())
+            return false;
 
-        data = m_queue.front();
+        data = std::move(m_queue.front());
         m_queue.pop();
+        return true;
     }
 
     void Pop(T& data, const std::function<bool()>& f)
     {
         std::unique_lock<std::mutex> lock(m_mutex);
-        while (m_queue.empty() && f())
+        while (m_queue.empty() && !m_closed && f())
+        {
+            ++m_waiters;
             m_signal.wait(lock);
+            --m_waiters;
+        }
 
-        if (!f())
+        if (!f() || m_queue.empty())
             return;
-        data = m_queue.front();
+        data = std::move(m_queue.front());
         m_queue.pop();
     }
 
@@ -64,21 +93,72 @@ public:
     bool TryPop(T& value, int32_t timeout_ms = 0)
     {
         std::unique_lock<std::mutex> lock(m_mutex);
-        if (m_queue.empty())
+        if (m_queue.empty() && !m_closed)
         {
-            if (m_signal.wait_for(lock, std::chrono::milliseconds(timeout_ms)) ==
-                std::cv_status::timeout)
-                return false;
-
-            if (m_queue.empty())
-                return false;
+            ++m_waiters;
+            m_signal.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                              [this] { return !m_queue.empty() || m_closed; });
+            --m_waiters;
         }
-        value = m_queue.front();
+        if (m_queue.empty())
+            return false;
+
+        value = std::move(m_queue.front());
         m_queue.pop();
         return true;
     }
 
-    bool Empty() const { return m_queue.empty(); }
+    /**
+     * @brief Wait for values and move up to max_count of them to out under a single lock
+     * @return the number of values popped, 0 if the queue is closed and empty
+     */
+    template <typename OutputIt>
+    size_t PopUpTo(size_t max_count, OutputIt out)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Wait(lock);
+        size_t count = 0;
+        for (; count < max_count && !m_queue.empty(); ++count)
+        {
+            *out++ = std::move(m_queue.front());
+            m_queue.pop();
+        }
+        return count;
+    }
+
+    /**
+     * @brief Wait for values and move all of them to out under a single lock
+     * @return the number of values popped, 0 if the queue is closed and empty
+     */
+    template <typename OutputIt>
+    size_t PopAll(OutputIt out)
+    {
+        return PopUpTo(static_cast<size_t>(-1), out);
+    }
+
+    /**
+     * @brief Reject further values and wake all waiting consumers
+     */
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_signal.notify_all();
+    }
+
+    bool IsClosed() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+
+    bool Empty() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.empty();
+    }
 
     void Clear()
     {
@@ -87,10 +167,25 @@ public:
         std::swap(m_queue, empty);
     }
 
-    size_t Size() const { return m_queue.size(); }
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size();
+    }
 
 private:
+    // wait until there is a value or the queue is closed
+    void Wait(std::unique_lock<std::mutex>& lock)
+    {
+        ++m_waiters;
+        m_signal.wait(lock, [this] { return !m_queue.empty() || m_closed; });
+        --m_waiters;
+    }
+
     std::queue<T> m_queue;
+    bool m_closed{false};
+    // number of consumers waiting on m_signal
+    uint32_t m_waiters{0};
     mutable std::mutex m_mutex;
     std::condition_variable m_signal;
 };
@@ -0,0 +1,72 @@
+/**************************************************************************
+ * @file:  CowPtr.h
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace cppbase {
+
+/**
+ * @brief Immutable reference counted buffer with copy-on-write
+ * @note  Copying a CowPtr only shares the value. GetMutable() copies the value first if it's
+ *   shared with other CowPtrs, so large payloads like point clouds can be passed around in
+ *   Variants, from processor results to the inputs of linked processors, without being copied
+ *   unless a consumer modifies them.
+ *   Different CowPtrs sharing a value can be used from different threads, one CowPtr can't.
+ */
+template <typename T>
+class CowPtr
+{
+public:
+    CowPtr() = default;
+    explicit CowPtr(T value) : m_data(std::make_shared<T>(std::move(value))) {}
+    explicit CowPtr(std::shared_ptr<T> data) : m_data(std::move(data)) {}
+
+    const T& Get() const { return *m_data; }
+    const T& operator*() const { return *m_data; }
+    const T* operator->() const { return m_data.get(); }
+
+    /**
+     * @brief Get the value for modification, copies it if it's shared
+     */
+    T& GetMutable()
+    {
+        if (m_data.use_count() > 1)
+        {
+            m_data = std::make_shared<T>(*m_data);
+        } else
+        {
+            // the other owners' reads happen before their release of the value
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *m_data;
+    }
+
+    bool IsUnique() const { return m_data.use_count() == 1; }
+    long UseCount() const { return m_data.use_count(); }
+
+    explicit operator bool() const { return static_cast<bool>(m_data); }
+
+    bool operator==(const CowPtr& other) const
+    {
+        return m_data == other.m_data || (m_data && other.m_data && *m_data == *other.m_data);
+    }
+    bool operator!=(const CowPtr& other) const { return !(*this == other); }
+
+private:
+    std::shared_ptr<T> m_data;
+};
+
+template <typename T, typename... Args>
+CowPtr<T> MakeCow(Args&&... args)
+{
+    return CowPtr<T>(std::make_shared<T>(std::forward<Args>(args)...));
+}
+
+}  // namespace cppbase
@@ -0,0 +1,311 @@
+/**************************************************************************
+ * @file:  CpuTopology.h
+ * @brief: CPU topology (packages, physical cores, SMT siblings, NUMA nodes)
+ *         and thread placement policies.
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "FileSystem.h"
+
+namespace cppbase {
+
+/**
+ * @brief Placement policy of thread pool workers
+ *   NONE           - don't set affinity, or use the legacy cpu_reserved round robin
+ *   EXPLICIT       - worker i is pinned to ThreadPlacement::cpus[i % size]
+ *   PHYSICAL_CORES - one worker per physical core, pinned to all SMT siblings of the core
+ *   COMPACT        - fill SMT siblings, then cores, then packages/nodes, i.e. keep workers close
+ *   SCATTER        - spread over packages/nodes first, then cores, then SMT siblings
+ */
+enum class PlacementPolicy : int32_t
+{
+    NONE = 0,
+    EXPLICIT,
+    PHYSICAL_CORES,
+    COMPACT,
+    SCATTER,
+};
+
+/**
+ * @brief Where the workers of a thread pool run
+ */
+struct ThreadPlacement
+{
+    PlacementPolicy policy{PlacementPolicy::NONE};
+    // the CPUs to use for EXPLICIT, optional restriction for the other policies
+    std::vector<uint32_t> cpus;
+    // CPUs that must not be used, e.g. the ones dedicated to the acquisition threads
+    std::vector<uint32_t> reserved_cpus;
+    // restrict the workers to one NUMA node, -1 for all nodes
+    int32_t numa_node{-1};
+};
+
+class CpuTopology
+{
+public:
+    struct Cpu
+    {
+        uint32_t id{0};
+        int32_t package{0};
+        int32_t core{0};
+        int32_t node{0};
+    };
+
+    /**
+     * @brief Get the topology of this machine, detected once
+     */
+    static const CpuTopology& Instance()
+    {
+        static CpuTopology topology = Detect();
+        return topology;
+    }
+
+    /**
+     * @brief Read the topology from sysfs
+     * @param sysfs_root Usually /sys/devices/system, with the cpu/ and node/ sub-directories
+     * @note  Falls back to std::thread::hardware_concurrency() CPUs in a single package and
+     *   node if the topology can't be read, e.g. on non-Linux systems.
+     */
+    static CpuTopology Detect(const std::string& sysfs_root = "/sys/devices/system")
+    {
+        CpuTopology topology;
+        fs::path root(sysfs_root);
+        std::string online;
+        if (ReadLine(root / "cpu" / "online", online))
+        {
+            for (auto id : ParseCpuList(online))
+            {
+                Cpu cpu;
+                cpu.id = id;
+                auto topo_dir = root / "cpu" / ("cpu" + std::to_string(id)) / "topology";
+                std::string value;
+                if (ReadLine(topo_dir / "physical_package_id", value))
+                    cpu.package = std::stoi(value);
+                cpu.core = static_cast<int32_t>(id);
+                if (ReadLine(topo_dir / "core_id", value))
+                    cpu.core = std::stoi(value);
+                topology.m_cpus.push_back(cpu);
+            }
+
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(root / "node", ec))
+            {
+                auto name = entry.path().filename().string();
+                std::string cpulist;
+                if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+                    name.find_first_not_of("0123456789", 4) != std::string::npos ||
+                    !ReadLine(entry.path() / "cpulist", cpulist))
+                    continue;
+                auto node = std::stoi(name.substr(4));
+                for (auto id : ParseCpuList(cpulist))
+                {
+                    for (auto& cpu : topology.m_cpus)
+                    {
+                        if (cpu.id == id)
+                            cpu.node = node;
+                    }
+                }
+            }
+        }
+
+        if (topology.m_cpus.empty())
+        {
+            auto count = std::max(std::thread::hardware_concurrency(), 1u);
+            for (uint32_t id = 0; id < count; ++id)
+                topology.m_cpus.push_back({id, 0, static_cast<int32_t>(id), 0});
+        }
+        return topology;
+    }
+
+    /**
+     * @brief Parse a sysfs cpu list, e.g. "0-3,8,10-11"
+     */
+    static std::vector<uint32_t> ParseCpuList(const std::string& list)
+    {
+        std::vector<uint32_t> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ','))
+        {
+            if (range.find_first_of("0123456789") == std::string::npos)
+                continue;
+            auto dash = range.find('-');
+            uint32_t first = std::stoul(range.substr(0, dash));
+            uint32_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            for (uint32_t id = first; id <= last; ++id)
+                cpus.push_back(id);
+        }
+        return cpus;
+    }
+
+    const std::vector<Cpu>& GetCpus() const { return m_cpus; }
+
+    const Cpu* GetCpu(uint32_t id) const
+    {
+        for (const auto& cpu : m_cpus)
+        {
+            if (cpu.id == id)
+                return &cpu;
+        }
+        return nullptr;
+    }
+
+    std::vector<int32_t> GetNodes() const
+    {
+        std::set<int32_t> nodes;
+        for (const auto& cpu : m_cpus)
+            nodes.insert(cpu.node);
+        return {nodes.begin(), nodes.end()};
+    }
+
+    uint32_t GetPackageCount() const
+    {
+        std::set<int32_t> packages;
+        for (const auto& cpu : m_cpus)
+            packages.insert(cpu.package);
+        return static_cast<uint32_t>(packages.size());
+    }
+
+    uint32_t GetPhysicalCoreCount() const { return static_cast<uint32_t>(GetCores().size()); }
+
+    /**
+     * @brief Compute the CPU set of every worker for the given placement
+     * @return one CPU set per worker, empty sets mean no affinity
+     */
+    std::vector<std::vector<uint32_t>> Place(const ThreadPlacement& placement,
+                                             uint32_t threads) const
+    {
+        std::vector<std::vector<uint32_t>> sets(threads);
+        if (placement.policy == PlacementPolicy::NONE || threads == 0)
+            return sets;
+
+        if (placement.policy == PlacementPolicy::EXPLICIT)
+        {
+            std::vector<uint32_t> cpus;
+            for (auto id : placement.cpus)
+            {
+                if (!Contains(placement.reserved_cpus, id))
+                    cpus.push_back(id);
+            }
+            for (uint32_t i = 0; i < threads && !cpus.empty(); ++i)
+                sets[i] = {cpus[i % cpus.size()]};
+            return sets;
+        }
+
+        // the usable CPUs grouped by physical core, ordered by node, package and core
+        std::vector<std::vector<uint32_t>> cores;
+        for (const auto& core : GetCores())
+        {
+            std::vector<uint32_t> siblings;
+            for (auto id : core)
+            {
+                const auto* cpu = GetCpu(id);
+                if (Contains(placement.reserved_cpus, id) ||
+                    (!placement.cpus.empty() && !Contains(placement.cpus, id)) ||
+                    (placement.numa_node >= 0 && cpu->node != placement.numa_node))
+                    continue;
+                siblings.push_back(id);
+            }
+            if (!siblings.empty())
+                cores.push_back(siblings);
+        }
+        if (cores.empty())
+            return sets;
+
+        std::vector<std::vector<uint32_t>> order;
+        switch (placement.policy)
+        {
+        case PlacementPolicy::PHYSICAL_CORES:
+            order = cores;
+            break;
+        case PlacementPolicy::COMPACT:
+            for (const auto& core : cores)
+            {
+                for (auto id : core)
+                    order.push_back({id});
+            }
+            break;
+        case PlacementPolicy::SCATTER:
+        {
+            // round robin over the packages, taking the n-th core of each package and the
+            // first SMT siblings before the second ones
+            std::map<std::pair<int32_t, int32_t>, std::vector<std::vector<uint32_t>>> domains;
+            for (const auto& core : cores)
+            {
+                const auto* cpu = GetCpu(core.front());
+                domains[{cpu->node, cpu->package}].push_back(core);
+            }
+            size_t max_cores = 0;
+            size_t max_siblings = 0;
+            for (const auto& domain : domains)
+            {
+                max_cores = std::max(max_cores, domain.second.size());
+                for (const auto& core : domain.second)
+                    max_siblings = std::max(max_siblings, core.size());
+            }
+            for (size_t smt = 0; smt < max_siblings; ++smt)
+            {
+                for (size_t c = 0; c < max_cores; ++c)
+                {
+                    for (const auto& domain : domains)
+                    {
+                        if (c < domain.second.size() && smt < domain.second[c].size())
+                            order.push_back({domain.second[c][smt]});
+                    }
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        for (uint32_t i = 0; i < threads; ++i)
+            sets[i] = order[i % order.size()];
+        return sets;
+    }
+
+private:
+    static bool ReadLine(const fs::path& path, std::string& line)
+    {
+        std::ifstream file(path);
+        return file && std::getline(file, line) && !line.empty();
+    }
+
+    static bool Contains(const std::vector<uint32_t>& cpus, uint32_t id)
+    {
+        return std::find(cpus.begin(), cpus.end(), id) != cpus.end();
+    }
+
+    // CPU ids grouped by physical core, ordered by node, package, core and CPU id
+    std::vector<std::vector<uint32_t>> GetCores() const
+    {
+        std::map<std::tuple<int32_t, int32_t, int32_t>, std::vector<uint32_t>> cores;
+        for (const auto& cpu : m_cpus)
+            cores[{cpu.node, cpu.package, cpu.core}].push_back(cpu.id);
+        std::vector<std::vector<uint32_t>> result;
+        for (auto& core : cores)
+        {
+            std::sort(core.second.begin(), core.second.end());
+            result.push_back(core.second);
+        }
+        return result;
+    }
+
+    std::vector<Cpu> m_cpus;
+};
+
+}  // namespace cppbase
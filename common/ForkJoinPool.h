@@ -1,61 +1,316 @@
 /**************************************************************************
  * @file: ForkJoinPool.h
- * @brief:
+ * @brief: Work-stealing fork/join pool with the interface of the Boost.Asio
+ *         fork_join example
  *
  * Copyright (c) 2022 O-Net Communications Inc.
  * All rights reserved.
  *************************************************************************/
 
+#pragma once
+
 #include <asio/execution.hpp>
-#include <asio/static_thread_pool.hpp>
 #include <algorithm>
-#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
 #include <thread>
-#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "Futex.h"
+#include "PoolAllocator.h"
+#include "Task.h"
 
 namespace asio {
 
+// Interface based on
 // https://raw.githubusercontent.com/boostorg/asio/develop/example/cpp14/executors/fork_join.cpp
 
-// A fixed-size thread pool used to implement fork/join semantics. Functions
-// are scheduled using a simple FIFO queue. Implementing work stealing, or
-// using a queue based on atomic operations, are left as tasks for the reader.
+namespace detail {
+
+// The outstanding work of one fork_executor and the first exception thrown by it.
+// Groups are reference counted intrusively: every copy of the executor and every
+// queued function holds a reference.
+class fork_join_group
+{
+public:
+  static fork_join_group* create()
+  {
+    cppbase::PoolAllocator<fork_join_group> allocator;
+    return new (allocator.allocate(1)) fork_join_group;
+  }
+
+  void add_ref() noexcept
+  {
+    ref_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void release() noexcept
+  {
+    if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      this->~fork_join_group();
+      cppbase::PoolAllocator<fork_join_group>().deallocate(this, 1);
+    }
+  }
+
+  // Record the exception being handled, unless an earlier one was recorded.
+  void fail() noexcept
+  {
+    if (!failed_.exchange(true))
+      error_ = std::current_exception();
+  }
+
+  std::atomic<uint32_t> work_count_{0};
+  std::atomic<uint32_t> waiters_{0};
+  std::atomic<bool> failed_{false};
+  std::exception_ptr error_;
+
+private:
+  fork_join_group() = default;
+  ~fork_join_group() = default;
+
+  std::atomic<uint32_t> ref_count_{1};
+};
+
+// A function queued in a fork_join_pool. Nodes are recycled through a per-thread free
+// list, and the function is stored inline in the node unless it is large, so forking
+// doesn't allocate in the steady state.
+struct fork_join_node
+{
+  cppbase::Task function_;
+  fork_join_group* group_ = nullptr;
+  fork_join_node* next_ = nullptr;
+};
+
+class fork_join_node_cache
+{
+public:
+  static fork_join_node* allocate()
+  {
+    auto& cache = instance();
+    if (fork_join_node* node = cache.head_)
+    {
+      cache.head_ = node->next_;
+      --cache.size_;
+      return node;
+    }
+    return new fork_join_node;
+  }
+
+  // Nodes may be freed on another thread than the one that allocated them. Each thread
+  // keeps a bounded number, so a thread that only forks can't grow the others' caches
+  // without limit.
+  static void free(fork_join_node* node) noexcept
+  {
+    auto& cache = instance();
+    if (cache.size_ >= max_cached)
+    {
+      delete node;
+      return;
+    }
+    node->next_ = cache.head_;
+    cache.head_ = node;
+    ++cache.size_;
+  }
+
+private:
+  static constexpr std::size_t max_cached = 1024;
+
+  ~fork_join_node_cache()
+  {
+    while (fork_join_node* node = head_)
+    {
+      head_ = node->next_;
+      delete node;
+    }
+  }
+
+  static fork_join_node_cache& instance()
+  {
+    static thread_local fork_join_node_cache cache;
+    return cache;
+  }
+
+  fork_join_node* head_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Chase-Lev work-stealing deque, in the C11 formulation of Le, Pop, Cohen and Zappa
+// Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+// The owner pushes and pops at the bottom, thieves steal from the top. Arrays replaced
+// when the deque grows are kept until the deque is destroyed, since a thief may still
+// read from them.
+class fork_join_deque
+{
+public:
+  fork_join_deque() : array_(new ring(64)) { arrays_.emplace_back(array_.load()); }
+
+  void push(fork_join_node* node)
+  {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    ring* a = array_.load(std::memory_order_relaxed);
+    if (b - t > a->capacity_ - 1)
+      a = grow(a, b, t);
+    a->put(b, node);
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  fork_join_node* pop()
+  {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    ring* a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    fork_join_node* node = a->get(b);
+    if (t == b)
+    {
+      // the last node, race the thieves for it
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+              std::memory_order_relaxed))
+        node = nullptr;
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return node;
+  }
+
+  fork_join_node* steal()
+  {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b)
+      return nullptr;
+    fork_join_node* node = array_.load(std::memory_order_acquire)->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+            std::memory_order_relaxed))
+      return nullptr;
+    return node;
+  }
+
+  bool empty() const
+  {
+    int64_t t = top_.load();
+    return bottom_.load() <= t;
+  }
+
+private:
+  struct ring
+  {
+    explicit ring(int64_t capacity)
+      : capacity_(capacity),
+        nodes_(new std::atomic<fork_join_node*>[static_cast<std::size_t>(capacity)])
+    {
+    }
+
+    fork_join_node* get(int64_t i) const
+    {
+      return nodes_[static_cast<std::size_t>(i & (capacity_ - 1))].load(
+          std::memory_order_relaxed);
+    }
+
+    void put(int64_t i, fork_join_node* node)
+    {
+      nodes_[static_cast<std::size_t>(i & (capacity_ - 1))].store(
+          node, std::memory_order_relaxed);
+    }
+
+    int64_t capacity_;
+    std::unique_ptr<std::atomic<fork_join_node*>[]> nodes_;
+  };
+
+  ring* grow(ring* a, int64_t b, int64_t t)
+  {
+    auto* bigger = new ring(a->capacity_ * 2);
+    arrays_.emplace_back(bigger);
+    for (int64_t i = t; i < b; ++i)
+      bigger->put(i, a->get(i));
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+  std::atomic<ring*> array_;
+  std::vector<std::unique_ptr<ring>> arrays_;
+};
+
+} // namespace detail
+
+// What a fork_executor does with a new function while the pool's queues are full.
+enum class fork_overflow_policy
+{
+  // Run the function on the forking thread before execute() returns.
+  run_inline,
+  // Wait until there is room. Pool threads run queued functions meanwhile, other
+  // threads sleep.
+  block
+};
+
+struct fork_join_options
+{
+  // Admission limit on the functions queued and not yet started, 0 for no limit.
+  // Forks that race at the limit may overshoot it by one function each.
+  uint32_t max_queued = 65536;
+  fork_overflow_policy overflow = fork_overflow_policy::run_inline;
+};
+
+struct fork_join_stats
+{
+  // functions queued and not yet started, and the most there have been at once
+  std::size_t queue_depth = 0;
+  std::size_t max_queue_depth = 0;
+  // functions run by the forking thread because the queues were full
+  uint64_t inline_executions = 0;
+  // forks that waited because the queues were full
+  uint64_t blocked_forks = 0;
+  // functions taken from another thread's deque
+  uint64_t steals = 0;
+};
+
+// A fixed-size work-stealing thread pool used to implement fork/join semantics.
+// Every thread owns a deque. Functions forked by a pool thread go to the bottom of its
+// own deque and are popped LIFO, idle threads steal the oldest functions from the top of
+// the other deques, and functions forked by other threads go to a shared queue. Threads
+// that join a fork_executor help by running queued functions until the work of the
+// executor is complete. The number of queued functions is bounded by
+// fork_join_options::max_queued, so deep recursive forks fall back to running inline
+// or wait instead of queueing without limit.
 class fork_join_pool
 {
 public:
   // The constructor starts a thread pool with the specified number of threads.
   // Note that the thread_count is not a fixed limit on the pool's concurrency.
-  // Additional threads may temporarily be added to the pool if they join a
+  // Additional threads may temporarily help the pool while they join a
   // fork_executor.
   explicit fork_join_pool(
-      std::size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u) * 2)
-    : use_count_(1),
-      threads_(thread_count)
+      std::size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u),
+      const fork_join_options& options = fork_join_options())
+    : deques_(std::max<std::size_t>(thread_count, 1)),
+      max_queued_(options.max_queued),
+      overflow_(options.overflow)
   {
     try
     {
-      // Ask each thread in the pool to dequeue and execute functions until
-      // it is time to shut down, i.e. the use count is zero.
-      for (thread_count_ = 0; thread_count_ < thread_count; ++thread_count_)
-      {
-        asio::execution::execute(
-            threads_.executor(),
-            [this]
-            {
-              std::unique_lock<std::mutex> lock(mutex_);
-              while (use_count_ > 0)
-                if (!execute_next(lock))
-                  condition_.wait(lock);
-            });
-      }
+      for (std::size_t i = 0; i < deques_.size(); ++i)
+        threads_.emplace_back([this, i] { worker_loop(i); });
     }
     catch (...)
     {
       stop_threads();
-      threads_.wait();
       throw;
     }
   }
@@ -64,102 +319,291 @@ public:
   ~fork_join_pool()
   {
     stop_threads();
-    threads_.wait();
+  }
+
+  fork_join_pool(const fork_join_pool&) = delete;
+  fork_join_pool& operator=(const fork_join_pool&) = delete;
+
+  std::size_t thread_count() const noexcept
+  {
+    return deques_.size();
+  }
+
+  // True if the calling thread has no queued functions, so forking more work may feed
+  // idle threads. For threads outside the pool this checks the shared queue.
+  bool local_queue_empty() const
+  {
+    int64_t index = current_index();
+    if (index < 0)
+      return shared_size_.load(std::memory_order_relaxed) == 0;
+    return deques_[static_cast<std::size_t>(index)].empty();
+  }
+
+  fork_join_stats stats() const noexcept
+  {
+    fork_join_stats stats;
+    stats.queue_depth = queued_.load(std::memory_order_relaxed);
+    stats.max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+    stats.inline_executions = inline_executions_.load(std::memory_order_relaxed);
+    stats.blocked_forks = blocked_forks_.load(std::memory_order_relaxed);
+    stats.steals = steals_.load(std::memory_order_relaxed);
+    return stats;
   }
 
 private:
   friend class fork_executor;
 
-  // The base for all functions that are queued in the pool.
-  struct function_base
+  struct worker_context
   {
-    std::shared_ptr<std::size_t> work_count_;
-    void (*execute_)(std::shared_ptr<function_base>& p);
+    fork_join_pool* pool_ = nullptr;
+    std::size_t index_ = 0;
   };
 
-  // Execute the next function from the queue, if any. Returns true if a
-  // function was executed, and false if the queue was empty.
-  bool execute_next(std::unique_lock<std::mutex>& lock)
+  static worker_context& current_worker()
+  {
+    static thread_local worker_context context;
+    return context;
+  }
+
+  // Index of the calling thread in this pool, or -1 for other threads.
+  int64_t current_index() const
   {
-    if (queue_.empty())
-      return false;
-    auto p(queue_.front());
-    queue_.pop();
-    lock.unlock();
-    execute(lock, p); 
-    return true;
+    auto& context = current_worker();
+    return context.pool_ == this ? static_cast<int64_t>(context.index_) : -1;
   }
 
-  // Execute a function and decrement the outstanding work.
-  void execute(std::unique_lock<std::mutex>& lock,
-      std::shared_ptr<function_base>& p)
+  void do_execute(cppbase::Task&& function, detail::fork_join_group* group)
   {
-    std::shared_ptr<std::size_t> work_count(std::move(p->work_count_));
+    if (max_queued_ > 0 && queued_.load(std::memory_order_relaxed) >= max_queued_)
+    {
+      if (overflow_ == fork_overflow_policy::run_inline)
+      {
+        inline_executions_.fetch_add(1, std::memory_order_relaxed);
+        try
+        {
+          function();
+        }
+        catch (...)
+        {
+          group->fail();
+        }
+        return;
+      }
+      wait_for_room();
+    }
+
+    detail::fork_join_node* node = detail::fork_join_node_cache::allocate();
+    node->function_ = std::move(function);
+    node->group_ = group;
+    group->add_ref();
+    group->work_count_.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t depth = queued_.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t max_depth = max_queue_depth_.load(std::memory_order_relaxed);
+    while (depth > max_depth && !max_queue_depth_.compare_exchange_weak(
+        max_depth, depth, std::memory_order_relaxed))
+    {
+    }
+
+    int64_t index = current_index();
+    if (index >= 0)
+    {
+      deques_[static_cast<std::size_t>(index)].push(node);
+    }
+    else
+    {
+      std::lock_guard<std::mutex> lock(shared_mutex_);
+      shared_.Push(std::move(node));
+      shared_size_.fetch_add(1);
+    }
+    wake_one();
+  }
+
+  // Execute a dequeued function and decrement the outstanding work of its group.
+  void execute(detail::fork_join_node* node) noexcept
+  {
+    // seq_cst orders the decrement with the load of blocked_, see wait_for_room()
+    uint32_t queued = queued_.fetch_sub(1);
+    if (queued <= max_queued_ && blocked_.load() > 0)
+      cppbase::Futex::Wake(queued_, 1);
+
+    detail::fork_join_group* group = node->group_;
     try
     {
-      p->execute_(p);
-      lock.lock();
-      do_work_finished(work_count);
+      node->function_();
     }
     catch (...)
     {
-      lock.lock();
-      do_work_finished(work_count);
-      throw;
+      group->fail();
     }
+    // release the captures before the group can be joined
+    node->function_.Reset();
+    node->group_ = nullptr;
+    detail::fork_join_node_cache::free(node);
+
+    if (group->work_count_.fetch_sub(1) == 1 && group->waiters_.load() > 0)
+      cppbase::Futex::WakeAll(group->work_count_);
+    group->release();
   }
 
-  // Increment outstanding work.
-  void do_work_started(const std::shared_ptr<std::size_t>& work_count) noexcept
+  // Wait until fewer than max_queued_ functions are queued. Pool threads run queued
+  // functions in the meantime, which also keeps the pool from deadlocking when all of
+  // its threads fork at the limit.
+  void wait_for_room()
   {
-    if (++(*work_count) == 1)
-      ++use_count_;
+    blocked_forks_.fetch_add(1, std::memory_order_relaxed);
+    int64_t index = current_index();
+    for (;;)
+    {
+      uint32_t queued = queued_.load(std::memory_order_relaxed);
+      if (queued < max_queued_)
+        break;
+      if (index >= 0)
+      {
+        if (auto* node = find_work(index))
+        {
+          execute(node);
+          continue;
+        }
+      }
+
+      blocked_.fetch_add(1);
+      queued = queued_.load();
+      if (queued >= max_queued_)
+        cppbase::Futex::WaitFor(queued_, queued, std::chrono::microseconds(200));
+      blocked_.fetch_sub(1);
+    }
   }
 
-  // Decrement outstanding work. Notify waiting threads if we run out.
-  void do_work_finished(const std::shared_ptr<std::size_t>& work_count) noexcept
+  // Find a function to execute: the own deque first, then the shared queue, then the
+  // other deques starting at a pseudo-random victim.
+  detail::fork_join_node* find_work(int64_t index)
   {
-    if (--(*work_count) == 0)
+    if (index >= 0)
     {
-      --use_count_;
-      condition_.notify_all();
+      if (auto* node = deques_[static_cast<std::size_t>(index)].pop())
+        return node;
     }
+
+    if (shared_size_.load(std::memory_order_relaxed) > 0)
+    {
+      std::lock_guard<std::mutex> lock(shared_mutex_);
+      if (!shared_.Empty())
+      {
+        shared_size_.fetch_sub(1);
+        return shared_.PopFront();
+      }
+    }
+
+    static thread_local uint32_t seed = static_cast<uint32_t>(
+        std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    std::size_t count = deques_.size();
+    std::size_t start = seed % count;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      std::size_t victim = (start + i) % count;
+      if (static_cast<int64_t>(victim) == index)
+        continue;
+      if (auto* node = deques_[victim].steal())
+      {
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  bool has_work() const
+  {
+    if (shared_size_.load() > 0)
+      return true;
+    for (auto& deque : deques_)
+      if (!deque.empty())
+        return true;
+    return false;
   }
 
-  // Dispatch a function, executing it immediately if the queue is already
-  // loaded. Otherwise adds the function to the queue and wakes a thread.
-  void do_execute(std::shared_ptr<function_base> p,
-      const std::shared_ptr<std::size_t>& work_count)
+  // Wake a sleeping pool thread if there is one. The fence pairs with the one in sleep(),
+  // so either the sleeper sees the new function or this sees the sleeper.
+  void wake_one()
   {
-    std::unique_lock<std::mutex> lock(mutex_);
-    if (queue_.size() > thread_count_ * 16)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0)
     {
-      do_work_started(work_count);
-      lock.unlock();
-      execute(lock, p);
+      epoch_.fetch_add(1);
+      cppbase::Futex::Wake(epoch_, 1);
     }
-    else
+  }
+
+  void sleep()
+  {
+    uint32_t epoch = epoch_.load();
+    sleepers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_work() && !stopped_.load())
+      cppbase::Futex::Wait(epoch_, epoch);
+    sleepers_.fetch_sub(1);
+  }
+
+  void worker_loop(std::size_t index)
+  {
+    auto& context = current_worker();
+    context.pool_ = this;
+    context.index_ = index;
+
+    for (;;)
     {
-      queue_.push(p);
-      do_work_started(work_count);
-      condition_.notify_one();
+      if (auto* node = find_work(static_cast<int64_t>(index)))
+      {
+        execute(node);
+        continue;
+      }
+      // functions still queued at shutdown are run before the threads exit
+      if (stopped_.load() && !has_work())
+        break;
+      sleep();
     }
+
+    context.pool_ = nullptr;
   }
 
-  // Ask all threads to shut down.
+  // Ask all threads to shut down once the queued functions have been executed.
   void stop_threads()
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    --use_count_;
-    condition_.notify_all();
+    stopped_.store(true);
+    epoch_.fetch_add(1);
+    cppbase::Futex::WakeAll(epoch_);
+    for (auto& thread : threads_)
+      thread.join();
+    threads_.clear();
   }
 
-  std::mutex mutex_;
-  std::condition_variable condition_;
-  std::queue<std::shared_ptr<function_base>> queue_;
-  std::size_t use_count_;
-  std::size_t thread_count_;
-  asio::static_thread_pool threads_;
+  std::vector<detail::fork_join_deque> deques_;
+  std::vector<std::thread> threads_;
+
+  // functions forked by threads outside the pool
+  std::mutex shared_mutex_;
+  cppbase::RingQueue<detail::fork_join_node*> shared_;
+  std::atomic<std::size_t> shared_size_{0};
+
+  // idle pool threads sleep on epoch_, which changes whenever they may have work
+  std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> sleepers_{0};
+  std::atomic<bool> stopped_{false};
+
+  // admission control, queued_ counts the functions queued and not yet started
+  const uint32_t max_queued_;
+  const fork_overflow_policy overflow_;
+  std::atomic<uint32_t> queued_{0};
+  std::atomic<uint32_t> blocked_{0};
+
+  std::atomic<uint32_t> max_queue_depth_{0};
+  std::atomic<uint64_t> inline_executions_{0};
+  std::atomic<uint64_t> blocked_forks_{0};
+  std::atomic<uint64_t> steals_{0};
 };
 
 // A class that satisfies the Executor requirements. Every function or piece of
@@ -168,76 +612,114 @@ class fork_executor
 {
 public:
   fork_executor(fork_join_pool& ctx)
-    : context_(ctx),
-      work_count_(std::make_shared<std::size_t>(0))
+    : context_(&ctx),
+      group_(detail::fork_join_group::create())
+  {
+  }
+
+  fork_executor(const fork_executor& other) noexcept
+    : context_(other.context_),
+      group_(other.group_)
+  {
+    group_->add_ref();
+  }
+
+  fork_executor& operator=(const fork_executor& other) noexcept
+  {
+    other.group_->add_ref();
+    group_->release();
+    context_ = other.context_;
+    group_ = other.group_;
+    return *this;
+  }
+
+  ~fork_executor()
   {
+    group_->release();
   }
 
   fork_join_pool& query(asio::execution::context_t) const noexcept
   {
-    return context_;
+    return *context_;
   }
 
   template <class Func>
   void execute(Func f) const
   {
-    auto p(std::make_shared<function<Func>>(std::move(f), work_count_));
-    context_.do_execute(p, work_count_);
+    context_->do_execute(cppbase::Task(std::move(f)), group_);
   }
 
   friend bool operator==(const fork_executor& a,
       const fork_executor& b) noexcept
   {
-    return a.work_count_ == b.work_count_;
+    return a.group_ == b.group_;
   }
 
   friend bool operator!=(const fork_executor& a,
       const fork_executor& b) noexcept
   {
-    return a.work_count_ != b.work_count_;
+    return a.group_ != b.group_;
   }
 
-  // Block until all work associated with the executor is complete. While it is
-  // waiting, the thread may be borrowed to execute functions from the queue.
+  // Block until all work associated with the executor is complete, then rethrow
+  // the first exception thrown by a function of the executor.
   void join() const
   {
-    std::unique_lock<std::mutex> lock(context_.mutex_);
-    while (*work_count_ > 0)
-      if (!context_.execute_next(lock))
-        context_.condition_.wait(lock);
+    wait();
+    if (group_->failed_.load(std::memory_order_acquire))
+    {
+      std::exception_ptr error;
+      std::swap(error, group_->error_);
+      group_->failed_.store(false);
+      if (error)
+        std::rethrow_exception(error);
+    }
   }
 
-private:
-  template <class Func>
-  struct function : fork_join_pool::function_base
+  // Block until all work associated with the executor is complete. While it is
+  // waiting, the thread executes queued functions of any executor, its own ones
+  // first if it is a pool thread. Unlike join() it doesn't throw, an exception
+  // of a function stays pending for the next join().
+  void wait() const
   {
-    explicit function(Func f, const std::shared_ptr<std::size_t>& w)
-      : function_(std::move(f))
+    auto& work_count = group_->work_count_;
+    int64_t index = context_->current_index();
+    for (;;)
     {
-      work_count_ = w;
-      execute_ = [](std::shared_ptr<fork_join_pool::function_base>& p)
+      uint32_t count = work_count.load(std::memory_order_acquire);
+      if (count == 0)
+        break;
+      if (auto* node = context_->find_work(index))
       {
-        Func tmp(std::move(static_cast<function*>(p.get())->function_));
-        p.reset();
-        tmp();
-      };
-    }
+        context_->execute(node);
+        continue;
+      }
 
-    Func function_;
-  };
+      // The remaining functions are running on other threads. Sleep until the last one
+      // finishes, or shortly in case they fork more work this thread could help with.
+      group_->waiters_.fetch_add(1);
+      count = work_count.load();
+      if (count > 0)
+        cppbase::Futex::WaitFor(work_count, count, std::chrono::microseconds(200));
+      group_->waiters_.fetch_sub(1);
+    }
+  }
 
-  fork_join_pool& context_;
-  std::shared_ptr<std::size_t> work_count_;
+private:
+  fork_join_pool* context_;
+  detail::fork_join_group* group_;
 };
 
-// Helper class to automatically join a fork_executor when exiting a scope.
+// Helper class to automatically wait for a fork_executor when exiting a scope.
+// The destructor doesn't throw, so it may run while an exception unwinds the
+// scope; call join() on the executor to get the exceptions of its functions.
 class join_guard
 {
 public:
   explicit join_guard(const fork_executor& ex) : ex_(ex) {}
   join_guard(const join_guard&) = delete;
   join_guard(join_guard&&) = delete;
-  ~join_guard() { ex_.join(); }
+  ~join_guard() { ex_.wait(); }
 
 private:
   fork_executor ex_;
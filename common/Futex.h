@@ -0,0 +1,126 @@
+/**************************************************************************
+ * @file:  Futex.h
+ * @brief: Wait on and wake up on a 32-bit atomic word
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#else
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#endif
+
+namespace cppbase {
+
+/**
+ * @brief Futex blocks a thread until another thread changes an atomic word and wakes it
+ * @note  On Linux it is the futex(2) system call, so waking costs nothing when nobody sleeps
+ *   and a sleeping thread needs no mutex. Elsewhere the calls are emulated with a small
+ *   table of mutexes and condition variables keyed by the address of the word. Waits may
+ *   return spuriously, callers must re-check their condition.
+ */
+class Futex
+{
+public:
+    /**
+     * @brief Sleep while word == expected, until woken
+     */
+    static void Wait(std::atomic<uint32_t>& word, uint32_t expected)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, Address(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+        auto& bucket = GetBucket(word);
+        std::unique_lock<std::mutex> lock(bucket.mutex);
+        if (word.load() == expected)
+            bucket.condition.wait(lock);
+#endif
+    }
+
+    /**
+     * @brief Sleep while word == expected, until woken or the timeout expires
+     * @return false if the timeout expired
+     */
+    static bool WaitFor(std::atomic<uint32_t>& word, uint32_t expected,
+                        std::chrono::nanoseconds timeout)
+    {
+        if (timeout.count() <= 0)
+            return false;
+#ifdef __linux__
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(seconds.count());
+        ts.tv_nsec = static_cast<long>((timeout - seconds).count());
+        auto rv = syscall(SYS_futex, Address(word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+        return rv == 0 || errno != ETIMEDOUT;
+#else
+        auto& bucket = GetBucket(word);
+        std::unique_lock<std::mutex> lock(bucket.mutex);
+        if (word.load() != expected)
+            return true;
+        return bucket.condition.wait_for(lock, timeout) == std::cv_status::no_timeout;
+#endif
+    }
+
+    /**
+     * @brief Wake up to count threads waiting on word
+     */
+    static void Wake(std::atomic<uint32_t>& word, uint32_t count = 1)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, Address(word), FUTEX_WAKE_PRIVATE,
+                count > INT_MAX ? INT_MAX : static_cast<int>(count), nullptr, nullptr, 0);
+#else
+        // threads of other words may share the bucket, so everybody has to re-check
+        (void)count;
+        auto& bucket = GetBucket(word);
+        {
+            std::lock_guard<std::mutex> lock(bucket.mutex);
+        }
+        bucket.condition.notify_all();
+#endif
+    }
+
+    static void WakeAll(std::atomic<uint32_t>& word) { Wake(word, UINT32_MAX); }
+
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                      std::atomic<uint32_t>::is_always_lock_free,
+                  "std::atomic<uint32_t> must be a plain 32-bit word");
+
+#ifdef __linux__
+    static uint32_t* Address(std::atomic<uint32_t>& word)
+    {
+        return reinterpret_cast<uint32_t*>(&word);
+    }
+#else
+    struct Bucket
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    static Bucket& GetBucket(std::atomic<uint32_t>& word)
+    {
+        static std::array<Bucket, 64> buckets;
+        return buckets[std::hash<void*>()(&word) % buckets.size()];
+    }
+#endif
+};
+
+}  // namespace cppbase
@@ -0,0 +1,270 @@
+/**************************************************************************
+ * @file:  MPMCQueue.h
+ * @brief: Bounded lock-free multi-producer multi-consumer queue
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cppbase {
+
+/**
+ * @brief What Push does when a bounded queue is full
+ *   BLOCK  - wait until a consumer makes room
+ *   REJECT - return false immediately and drop the value
+ */
+enum class BackpressurePolicy : int32_t
+{
+    BLOCK = 0,
+    REJECT = 1,
+};
+
+/**
+ * @brief MPMCQueue is a bounded alternative to BlockingQueue for hot producer/consumer paths
+ * @note  The queue is a ring buffer of cells carrying sequence numbers (D. Vyukov's bounded
+ *   MPMC queue), so producers and consumers only contend on one atomic each and never take a
+ *   lock while the queue is neither full nor empty. The mutex and condition variables are only
+ *   used to park threads that have to wait. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MPMCQueue
+{
+public:
+    explicit MPMCQueue(size_t capacity, BackpressurePolicy policy = BackpressurePolicy::BLOCK)
+        : m_policy(policy)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        m_mask = size - 1;
+        m_cells = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MPMCQueue()
+    {
+        auto end = m_enqueue_pos.load();
+        for (auto pos = m_dequeue_pos.load(); pos != end; ++pos)
+            std::launder(reinterpret_cast<T*>(&m_cells[pos & m_mask].storage))->~T();
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    /**
+     * @brief Push a value, waiting for room or rejecting it according to the policy
+     * @return false if the queue is full and the policy is REJECT
+     */
+    bool Push(const T& data) { return PushImpl(data); }
+    bool Push(T&& data) { return PushImpl(std::move(data)); }
+
+    /**
+     * @brief Push a value if there is room, regardless of the policy
+     */
+    bool TryPush(const T& data) { return TryPushImpl(data); }
+    bool TryPush(T&& data) { return TryPushImpl(std::move(data)); }
+
+    void Pop(T& data)
+    {
+        while (!TryPopImpl(data))
+            Wait(m_pop_waiters, m_not_empty, [this] { return FrontReady(); });
+    }
+
+    bool TryPop(T& value, int32_t timeout_ms = 0)
+    {
+        if (TryPopImpl(value))
+            return true;
+        if (timeout_ms <= 0)
+            return false;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        do
+        {
+            if (!WaitUntil(m_pop_waiters, m_not_empty, deadline, [this] { return FrontReady(); }))
+                return TryPopImpl(value);
+        } while (!TryPopImpl(value));
+        return true;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    /**
+     * @brief Approximate number of values, exact when no push or pop is in flight
+     */
+    size_t Size() const
+    {
+        auto dequeue_pos = m_dequeue_pos.load(std::memory_order_acquire);
+        auto enqueue_pos = m_enqueue_pos.load(std::memory_order_acquire);
+        return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    }
+
+    size_t Capacity() const { return m_mask + 1; }
+    BackpressurePolicy GetPolicy() const { return m_policy; }
+
+    /**
+     * @brief Number of values dropped by Push because the queue was full
+     */
+    uint64_t GetRejectedCount() const { return m_rejected.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence{0};
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    static constexpr size_t kCacheLine = 64;
+
+    template <typename U>
+    bool PushImpl(U&& data)
+    {
+        while (!TryPushImpl(std::forward<U>(data)))
+        {
+            if (m_policy == BackpressurePolicy::REJECT)
+            {
+                m_rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            Wait(m_push_waiters, m_not_full, [this] { return BackFree(); });
+        }
+        return true;
+    }
+
+    // only forwards data once a cell has been claimed, so a failed attempt leaves it intact
+    template <typename U>
+    bool TryPushImpl(U&& data)
+    {
+        Cell* cell;
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0)
+            {
+                return false;  // full
+            } else
+            {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        new (&cell->storage) T(std::forward<U>(data));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        Notify(m_pop_waiters, m_not_empty);
+        return true;
+    }
+
+    bool TryPopImpl(T& data)
+    {
+        Cell* cell;
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0)
+            {
+                return false;  // empty
+            } else
+            {
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        auto* value = std::launder(reinterpret_cast<T*>(&cell->storage));
+        data = std::move(*value);
+        value->~T();
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        Notify(m_push_waiters, m_not_full);
+        return true;
+    }
+
+    // a value is ready at the head of the queue
+    bool FrontReady() const
+    {
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    // a cell is free at the tail of the queue
+    bool BackFree() const
+    {
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos;
+    }
+
+    // Waiters register themselves before re-checking the queue and the other side checks for
+    // waiters after publishing, the fences order the two so one of them sees the other.
+    void Notify(std::atomic<uint32_t>& waiters, std::condition_variable& condition)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            condition.notify_one();
+        }
+    }
+
+    template <typename Predicate>
+    void Wait(std::atomic<uint32_t>& waiters, std::condition_variable& condition, Predicate ready)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        condition.wait(lock, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <typename Predicate>
+    bool WaitUntil(std::atomic<uint32_t>& waiters, std::condition_variable& condition,
+                   std::chrono::steady_clock::time_point deadline, Predicate ready)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool result = condition.wait_until(lock, deadline, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    // producers and consumers each get their own cache line
+    alignas(kCacheLine) std::atomic<size_t> m_enqueue_pos{0};
+    alignas(kCacheLine) std::atomic<size_t> m_dequeue_pos{0};
+    alignas(kCacheLine) std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask{0};
+    BackpressurePolicy m_policy;
+    std::atomic<uint64_t> m_rejected{0};
+
+    // parking of blocked producers and consumers
+    alignas(kCacheLine) std::atomic<uint32_t> m_pop_waiters{0};
+    std::atomic<uint32_t> m_push_waiters{0};
+    std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+};
+
+}  // namespace cppbase
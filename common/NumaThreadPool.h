@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * @file: NumaThreadPool.h
+ * @brief: One ThreadPool per NUMA node with node-local task queues
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ ****************************************************************************/
+
+#pragma once
+
+#include "ThreadPool.h"
+
+namespace cppbase {
+
+/**
+ * @brief NumaThreadPool runs a separate ThreadPool on every NUMA node. The workers of a node
+ *   only run on the node's CPUs and only take tasks from the node's own queues, so the data a
+ *   task touches stays in the node's memory and caches.
+ */
+class NumaThreadPool
+{
+public:
+    /**
+     * @brief Construct a pool per NUMA node
+     * @param threads_per_node Number of workers per node, 0 for one per physical core
+     * @param priority Thread priority of the workers
+     * @param options Options of the node pools. The placement policy defaults to COMPACT and
+     *   is always restricted to the node.
+     */
+    NumaThreadPool(uint32_t threads_per_node, ThreadPriority priority,
+                   const ThreadPoolOptions& options = {})
+        : m_topology(CpuTopology::Instance())
+    {
+        for (auto node : m_topology.GetNodes())
+        {
+            auto node_options = options;
+            if (node_options.placement.policy == PlacementPolicy::NONE)
+                node_options.placement.policy = PlacementPolicy::COMPACT;
+            node_options.placement.numa_node = node;
+
+            auto threads = threads_per_node;
+            if (threads == 0)
+            {
+                ThreadPlacement cores;
+                cores.policy = PlacementPolicy::PHYSICAL_CORES;
+                cores.numa_node = node;
+                cores.reserved_cpus = options.placement.reserved_cpus;
+                std::set<std::vector<uint32_t> > unique;
+                for (const auto& set :
+                     m_topology.Place(cores, m_topology.GetPhysicalCoreCount()))
+                    unique.insert(set);
+                threads = std::max<uint32_t>(static_cast<uint32_t>(unique.size()), 1);
+            }
+            m_nodes.push_back(node);
+            m_pools.push_back(std::make_unique<ThreadPool>(threads, priority, 0, node_options));
+        }
+    }
+    NumaThreadPool() = delete;
+    DISALLOW_COPY_AND_ASSIGN(NumaThreadPool);
+
+    uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_pools.size()); }
+
+    /**
+     * @brief Get the NUMA node ids, in the same order as the indices used by GetPool()
+     */
+    const std::vector<int32_t>& GetNodes() const { return m_nodes; }
+
+    ThreadPool& GetPool(uint32_t index) { return *m_pools.at(index); }
+
+    /**
+     * @brief Get the index of the node the calling thread currently runs on
+     */
+    uint32_t CurrentNodeIndex() const
+    {
+#ifdef __linux__
+        int cpu_id = sched_getcpu();
+        if (cpu_id >= 0)
+        {
+            if (const auto* cpu = m_topology.GetCpu(static_cast<uint32_t>(cpu_id)))
+            {
+                for (uint32_t i = 0; i < m_nodes.size(); ++i)
+                {
+                    if (m_nodes[i] == cpu->node)
+                        return i;
+                }
+            }
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * @brief Enqueue a task on the given node
+     */
+    template <class F, class... Args>
+    auto Enqueue(uint32_t node_index, F&& f, Args&&... args)
+    {
+        return GetPool(node_index).Enqueue(std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Enqueue a task on the node of the calling thread
+     */
+    template <class F, class... Args,
+              typename = std::enable_if_t<!std::is_integral_v<std::decay_t<F> > > >
+    auto Enqueue(F&& f, Args&&... args)
+    {
+        return Enqueue(CurrentNodeIndex(), std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+private:
+    const CpuTopology& m_topology;
+    std::vector<int32_t> m_nodes;
+    std::vector<std::unique_ptr<ThreadPool> > m_pools;
+};
+
+}  // namespace cppbase
@@ -0,0 +1,438 @@
+/**************************************************************************
+ * @file:  ParallelAlgorithms.h
+ * @brief: Data-parallel loops, reductions, transforms, sorting and scans
+ *         on top of asio::fork_join_pool
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "ForkJoinPool.h"
+
+namespace cppbase {
+
+/**
+ * @brief Cancels a parallel algorithm from any thread. Copies share the same state.
+ */
+class CancellationToken
+{
+public:
+    CancellationToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void Cancel() { m_cancelled->store(true, std::memory_order_relaxed); }
+    bool IsCancelled() const { return m_cancelled->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+/**
+ * @brief Optional settings of the parallel algorithms
+ */
+struct ParallelOptions
+{
+    // number of elements a task processes between checks for idle threads and cancellation,
+    // zero picks one from the range size and the thread count
+    size_t grain_size{0};
+    std::optional<CancellationToken> cancellation;
+};
+
+namespace internal {
+
+/**
+ * @brief State shared by the tasks of one parallel algorithm call
+ */
+class ParallelContext
+{
+public:
+    ParallelContext(asio::fork_join_pool& pool, size_t size, const ParallelOptions& options)
+        : m_pool(pool), m_fork(pool), m_options(options)
+    {
+        m_grain = options.grain_size;
+        if (m_grain == 0)
+        {
+            auto threads = std::max<size_t>(pool.thread_count(), 1);
+            m_grain = std::clamp<size_t>(size / (threads * 256), 1, 16384);
+        }
+    }
+
+    asio::fork_join_pool& GetPool() { return m_pool; }
+    const asio::fork_executor& GetExecutor() const { return m_fork; }
+    size_t GetGrainSize() const { return m_grain; }
+
+    bool IsStopped() const
+    {
+        return m_stopped.load(std::memory_order_relaxed) ||
+               (m_options.cancellation && m_options.cancellation->IsCancelled());
+    }
+
+    // stop the other tasks early, e.g. after an exception
+    void Stop() { m_stopped.store(true, std::memory_order_relaxed); }
+
+    /**
+     * @brief Run f on the calling thread, then wait for all forked tasks
+     * @note  Rethrows the first exception thrown by f or any task, after all tasks finished.
+     * @return false if the algorithm was cancelled
+     */
+    template <typename F>
+    bool Run(F&& f)
+    {
+        std::exception_ptr error;
+        try
+        {
+            f();
+        } catch (...)
+        {
+            Stop();
+            error = std::current_exception();
+        }
+        try
+        {
+            m_fork.join();
+        } catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+        }
+        if (error)
+            std::rethrow_exception(error);
+        return !(m_options.cancellation && m_options.cancellation->IsCancelled());
+    }
+
+    template <typename F>
+    void Fork(F&& f)
+    {
+        asio::execution::execute(m_fork, [this, f = std::forward<F>(f)]() mutable {
+            try
+            {
+                f();
+            } catch (...)
+            {
+                Stop();
+                throw;
+            }
+        });
+    }
+
+private:
+    asio::fork_join_pool& m_pool;
+    asio::fork_executor m_fork;
+    const ParallelOptions& m_options;
+    size_t m_grain{1};
+    std::atomic<bool> m_stopped{false};
+};
+
+/**
+ * @brief Lazy binary splitting: process [first, last) grain by grain, and whenever the
+ *   thread's own queue is empty, which means other threads may be idle, fork the upper half
+ *   of the remaining range as a new task. Ranges are only split when there is demand, so the
+ *   number of tasks adapts to the load instead of being fixed upfront.
+ * @param body Called as body(first, last, state) for every chunk
+ * @param make_state Creates the per-task state passed to body
+ * @param finish Called as finish(state) when a task has processed its range
+ */
+template <typename Index, typename Body, typename MakeState, typename Finish>
+void LazySplit(ParallelContext& context, Index first, Index last, Body& body,
+               MakeState& make_state, Finish& finish)
+{
+    auto state = make_state();
+    auto grain = static_cast<decltype(last - first)>(context.GetGrainSize());
+    while (first < last && !context.IsStopped())
+    {
+        if (last - first > grain && context.GetPool().local_queue_empty())
+        {
+            Index middle = first + (last - first) / 2;
+            context.Fork([&context, middle, last, &body, &make_state, &finish] {
+                LazySplit(context, middle, last, body, make_state, finish);
+            });
+            last = middle;
+            continue;
+        }
+        Index end = last - first > grain ? first + grain : last;
+        body(first, end, state);
+        first = end;
+    }
+    finish(state);
+}
+
+template <typename Index, typename Body>
+bool ParallelChunks(asio::fork_join_pool& pool, Index first, Index last, Body body,
+                    const ParallelOptions& options)
+{
+    if (!(first < last))
+        return true;
+    ParallelContext context(pool, static_cast<size_t>(last - first), options);
+    auto make_state = [] { return 0; };
+    auto chunk = [&body](Index begin, Index end, int) { body(begin, end); };
+    auto finish = [](int) {};
+    return context.Run([&] { LazySplit(context, first, last, chunk, make_state, finish); });
+}
+
+}  // namespace internal
+
+/**
+ * @brief Call f(i) for every i in [first, last) in parallel
+ * @note  Exceptions thrown by f stop the remaining iterations and the first one is rethrown
+ *   by the calling thread once all running tasks have finished.
+ * @return false if the loop was cancelled before all iterations ran
+ */
+template <typename Index, typename F>
+bool ParallelFor(asio::fork_join_pool& pool, Index first, Index last, F&& f,
+                 const ParallelOptions& options = {})
+{
+    static_assert(std::is_integral_v<Index>, "ParallelFor needs an integral index");
+    return internal::ParallelChunks(
+        pool, first, last,
+        [&f](Index begin, Index end) {
+            for (Index i = begin; i < end; ++i)
+                f(i);
+        },
+        options);
+}
+
+/**
+ * @brief Reduce [first, last) with op, starting from init, like std::reduce
+ * @note  op must be associative and commutative, the grouping of the elements depends on
+ *   how the range was split. The result of a cancelled reduction is unspecified.
+ */
+template <typename RandomIt, typename T, typename ReduceOp, typename TransformOp>
+T ParallelReduce(asio::fork_join_pool& pool, RandomIt first, RandomIt last, T init,
+                 ReduceOp reduce, TransformOp transform, const ParallelOptions& options = {})
+{
+    if (first == last)
+        return init;
+
+    std::mutex mutex;
+    T result = std::move(init);
+    internal::ParallelContext context(pool, static_cast<size_t>(last - first), options);
+    auto make_state = [] { return std::optional<T>(); };
+    auto body = [&](RandomIt begin, RandomIt end, std::optional<T>& partial) {
+        // accumulate the chunk in a local first, which the compiler can keep in registers
+        T sum = transform(*begin++);
+        for (; begin != end; ++begin)
+            sum = reduce(std::move(sum), transform(*begin));
+        if (partial)
+            partial = reduce(std::move(*partial), std::move(sum));
+        else
+            partial.emplace(std::move(sum));
+    };
+    auto finish = [&](std::optional<T>& partial) {
+        if (partial)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            result = reduce(std::move(result), std::move(*partial));
+        }
+    };
+    context.Run([&] { internal::LazySplit(context, first, last, body, make_state, finish); });
+    return result;
+}
+
+template <typename RandomIt, typename T, typename ReduceOp = std::plus<>>
+T ParallelReduce(asio::fork_join_pool& pool, RandomIt first, RandomIt last, T init,
+                 ReduceOp reduce = {})
+{
+    return ParallelReduce(pool, first, last, std::move(init), reduce,
+                          [](const auto& value) -> const auto& { return value; });
+}
+
+/**
+ * @brief Store op(x) for every x in [first, last) to the range starting at d_first
+ * @return the end of the destination range, or d_first if the transform was cancelled, in
+ *   which case the destination range is partially written
+ */
+template <typename RandomIt, typename OutputIt, typename UnaryOp>
+OutputIt ParallelTransform(asio::fork_join_pool& pool, RandomIt first, RandomIt last,
+                           OutputIt d_first, UnaryOp op, const ParallelOptions& options = {})
+{
+    using Diff = typename std::iterator_traits<RandomIt>::difference_type;
+    bool completed = internal::ParallelChunks(
+        pool, Diff(0), last - first,
+        [&](Diff begin, Diff end) { std::transform(first + begin, first + end, d_first + begin, op); },
+        options);
+    if (!completed)
+        return d_first;
+    return d_first + (last - first);
+}
+
+namespace internal {
+
+// merge sort that alternates between the data and the buffer, so every level merges once
+// without copying back; the sorted result ends up in the buffer if to_buffer is set
+template <typename RandomIt, typename BufferIt, typename Compare>
+void ParallelMergeSort(ParallelContext& context, RandomIt first, RandomIt last,
+                       BufferIt buffer, bool to_buffer, Compare& comp, size_t cutoff)
+{
+    // the range of a stopped sort is left as it is
+    if (context.IsStopped())
+        return;
+    auto size = static_cast<size_t>(last - first);
+    if (size <= cutoff)
+    {
+        std::sort(first, last, comp);
+        if (to_buffer)
+            std::move(first, last, buffer);
+        return;
+    }
+
+    auto half = last - first;
+    half /= 2;
+    RandomIt middle = first + half;
+    BufferIt buffer_middle = buffer + half;
+    // a group per level, so the merge only waits for its own two halves
+    asio::fork_executor fork(context.GetPool());
+    asio::execution::execute(fork, [&context, first, middle, buffer, to_buffer, &comp, cutoff] {
+        ParallelMergeSort(context, first, middle, buffer, !to_buffer, comp, cutoff);
+    });
+    try
+    {
+        ParallelMergeSort(context, middle, last, buffer_middle, !to_buffer, comp, cutoff);
+    } catch (...)
+    {
+        context.Stop();
+        fork.join();
+        throw;
+    }
+    fork.join();
+    // a half skipped by a stopped sort isn't sorted, nor moved to where the merge reads it
+    if (context.IsStopped())
+        return;
+
+    auto buffer_last = buffer + (last - first);
+    if (to_buffer)
+        std::merge(std::make_move_iterator(first), std::make_move_iterator(middle),
+                   std::make_move_iterator(middle), std::make_move_iterator(last), buffer,
+                   comp);
+    else
+        std::merge(std::make_move_iterator(buffer), std::make_move_iterator(buffer_middle),
+                   std::make_move_iterator(buffer_middle), std::make_move_iterator(buffer_last),
+                   first, comp);
+}
+
+}  // namespace internal
+
+/**
+ * @brief Sort [first, last) with a parallel merge sort, stable ties are not guaranteed
+ * @note  Uses a temporary buffer of last - first elements, the value type must be default
+ *   constructible. A cancelled sort leaves the elements in a valid but unspecified state.
+ * @return false if the sort was cancelled
+ */
+template <typename RandomIt, typename Compare = std::less<>>
+bool ParallelSort(asio::fork_join_pool& pool, RandomIt first, RandomIt last, Compare comp = {},
+                  const ParallelOptions& options = {})
+{
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    auto size = static_cast<size_t>(last - first);
+    auto threads = std::max<size_t>(pool.thread_count(), 1);
+    // leaves are sorted with std::sort, several per thread to balance uneven leaves
+    size_t cutoff = options.grain_size ? options.grain_size
+                                       : std::max<size_t>(size / (threads * 8), 4096);
+    if (size <= cutoff)
+    {
+        if (options.cancellation && options.cancellation->IsCancelled())
+            return false;
+        std::sort(first, last, comp);
+        return true;
+    }
+
+    std::vector<Value> buffer(size);
+    internal::ParallelContext context(pool, size, options);
+    return context.Run([&] {
+        internal::ParallelMergeSort(context, first, last, buffer.begin(), false, comp, cutoff);
+    });
+}
+
+/**
+ * @brief Inclusive scan of [first, last) with op to the range starting at d_first, like
+ *   std::inclusive_scan
+ * @note  Two passes over fixed blocks: the blocks are reduced in parallel, the block sums are
+ *   scanned serially, then the blocks are scanned in parallel starting from their offsets.
+ *   op must be associative.
+ * @return the end of the destination range, or d_first if the scan was cancelled, in which
+ *   case the destination range is partially written
+ */
+template <typename RandomIt, typename OutputIt, typename BinaryOp = std::plus<>>
+OutputIt ParallelScan(asio::fork_join_pool& pool, RandomIt first, RandomIt last,
+                      OutputIt d_first, BinaryOp op = {}, const ParallelOptions& options = {})
+{
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    auto size = static_cast<size_t>(last - first);
+    if (size == 0)
+        return d_first;
+
+    auto threads = std::max<size_t>(pool.thread_count(), 1);
+    size_t block = options.grain_size ? options.grain_size
+                                      : std::max<size_t>(size / (threads * 8), 4096);
+    size_t blocks = (size + block - 1) / block;
+    if (blocks == 1)
+    {
+        if (options.cancellation && options.cancellation->IsCancelled())
+            return d_first;
+        return std::inclusive_scan(first, last, d_first, op);
+    }
+
+    ParallelOptions block_options = options;
+    block_options.grain_size = 1;
+    std::vector<std::optional<Value>> sums(blocks);
+    bool completed = internal::ParallelChunks(
+        pool, size_t(0), blocks - 1,
+        [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b)
+            {
+                auto it = first + b * block;
+                auto block_end = it + block;
+                Value sum = *it++;
+                for (; it != block_end; ++it)
+                    sum = op(std::move(sum), *it);
+                sums[b] = std::move(sum);
+            }
+        },
+        block_options);
+    // the sums of the blocks skipped by a cancelled pass are missing
+    if (!completed)
+        return d_first;
+
+    // sums[b] becomes the scan of everything before block b + 1, sums[b - 1] is still read by
+    // the second pass so it's copied, not moved
+    for (size_t b = 1; b + 1 < blocks; ++b)
+        sums[b] = op(*sums[b - 1], std::move(*sums[b]));
+
+    completed = internal::ParallelChunks(
+        pool, size_t(0), blocks,
+        [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b)
+            {
+                auto it = first + b * block;
+                auto block_end = b + 1 == blocks ? last : it + block;
+                auto out = d_first + b * block;
+                if (b == 0)
+                {
+                    std::inclusive_scan(it, block_end, out, op);
+                } else
+                {
+                    Value sum = *sums[b - 1];
+                    for (; it != block_end; ++it, ++out)
+                    {
+                        sum = op(std::move(sum), *it);
+                        *out = sum;
+                    }
+                }
+            }
+        },
+        block_options);
+    return completed ? d_first + size : d_first;
+}
+
+}  // namespace cppbase
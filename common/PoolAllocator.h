@@ -0,0 +1,268 @@
+/**************************************************************************
+ * @file:  PoolAllocator.h
+ * @brief: Standard allocator that recycles small blocks through
+ *         process-wide size-class free lists with per-thread caches.
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace cppbase {
+
+namespace internal {
+
+/**
+ * @brief BlockPool keeps one free list per size class. Blocks are carved from the global heap
+ *   on first use and are never returned to it.
+ * @note  Every thread caches a few blocks per size class in front of the shared lists, and
+ *   moves blocks between its cache and the shared lists in batches, so the lock of a shared
+ *   list is taken once per batch rather than once per block. Blocks may be released by
+ *   another thread than the one that allocated them, e.g. a promise's shared state.
+ */
+class BlockPool
+{
+public:
+    static constexpr size_t kGranularity = alignof(std::max_align_t);
+    static constexpr size_t kMaxBlockSize = 512;
+    // blocks moved between a thread cache and a shared list at once
+    static constexpr uint32_t kBatchSize = 32;
+    // blocks of a size class a thread cache holds before it returns a batch
+    static constexpr uint32_t kMaxCached = 2 * kBatchSize;
+
+    static BlockPool& Instance()
+    {
+        // intentionally leaked, blocks may still be released during static destruction
+        static BlockPool* pool = new BlockPool;
+        return *pool;
+    }
+
+    static constexpr bool IsPooled(size_t bytes, size_t alignment)
+    {
+        return bytes > 0 && bytes <= kMaxBlockSize && alignment <= kGranularity;
+    }
+
+    void* Allocate(size_t bytes)
+    {
+        auto size_class = SizeClass(bytes);
+        if (auto* cache = GetThreadCache())
+        {
+            auto& local = cache->lists[size_class];
+            if (!local.head)
+                local.count = Pop(m_lists[size_class], local.head, kBatchSize);
+            if (local.head)
+            {
+                auto* block = local.head;
+                local.head = block->next;
+                --local.count;
+                return block;
+            }
+        } else
+        {
+            FreeBlock* block = nullptr;
+            if (Pop(m_lists[size_class], block, 1))
+                return block;
+        }
+        return ::operator new((size_class + 1) * kGranularity);
+    }
+
+    void Deallocate(void* p, size_t bytes) noexcept
+    {
+        auto size_class = SizeClass(bytes);
+        auto* block = static_cast<FreeBlock*>(p);
+        auto* cache = GetThreadCache();
+        if (!cache)
+        {
+            block->next = nullptr;
+            Push(m_lists[size_class], block, block);
+            return;
+        }
+
+        auto& local = cache->lists[size_class];
+        block->next = local.head;
+        local.head = block;
+        if (++local.count > kMaxCached)
+        {
+            // keep the most recently released blocks, they're the likeliest to be in cache
+            auto* last = local.head;
+            for (uint32_t i = 1; i < kMaxCached - kBatchSize; ++i)
+                last = last->next;
+            auto* first = last->next;
+            last->next = nullptr;
+            local.count = kMaxCached - kBatchSize;
+            auto* tail = first;
+            while (tail->next)
+                tail = tail->next;
+            Push(m_lists[size_class], first, tail);
+        }
+    }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct alignas(64) FreeList
+    {
+        std::mutex mutex;
+        FreeBlock* head{nullptr};
+    };
+
+    static constexpr size_t kSizeClasses = kMaxBlockSize / kGranularity;
+
+    // trivially destructible, so it is still accessible while other thread_local objects are
+    // destroyed; the blocks are returned to the shared lists by the ThreadCacheFlusher
+    struct ThreadCache
+    {
+        enum State : uint8_t
+        {
+            UNUSED,
+            ACTIVE,
+            RELEASED
+        };
+
+        struct LocalList
+        {
+            FreeBlock* head;
+            uint32_t count;
+        };
+
+        State state;
+        std::array<LocalList, kSizeClasses> lists;
+    };
+
+    struct ThreadCacheFlusher
+    {
+        ~ThreadCacheFlusher() { BlockPool::Instance().ReleaseThreadCache(); }
+    };
+
+    BlockPool() = default;
+
+    static constexpr size_t SizeClass(size_t bytes) { return (bytes - 1) / kGranularity; }
+
+    static ThreadCache& GetThreadCacheStorage()
+    {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+
+    /**
+     * @brief Get the cache of the calling thread, nullptr once the thread released it on exit
+     */
+    static ThreadCache* GetThreadCache()
+    {
+        auto& cache = GetThreadCacheStorage();
+        if (cache.state == ThreadCache::UNUSED)
+        {
+            cache.state = ThreadCache::ACTIVE;
+            static thread_local ThreadCacheFlusher flusher;
+            (void)flusher;
+        }
+        return cache.state == ThreadCache::ACTIVE ? &cache : nullptr;
+    }
+
+    void ReleaseThreadCache() noexcept
+    {
+        auto& cache = GetThreadCacheStorage();
+        cache.state = ThreadCache::RELEASED;
+        for (size_t i = 0; i < kSizeClasses; ++i)
+        {
+            auto& local = cache.lists[i];
+            if (!local.head)
+                continue;
+            auto* tail = local.head;
+            while (tail->next)
+                tail = tail->next;
+            Push(m_lists[i], local.head, tail);
+            local.head = nullptr;
+            local.count = 0;
+        }
+    }
+
+    // pop up to count blocks as a list into head, return the number of blocks popped
+    static uint32_t Pop(FreeList& list, FreeBlock*& head, uint32_t count)
+    {
+        std::lock_guard<std::mutex> lock(list.mutex);
+        head = list.head;
+        uint32_t popped = 0;
+        FreeBlock* last = nullptr;
+        for (auto* block = list.head; block && popped < count; block = block->next, ++popped)
+            last = block;
+        if (last)
+        {
+            list.head = last->next;
+            last->next = nullptr;
+        }
+        return popped;
+    }
+
+    // push the list [first, last]
+    static void Push(FreeList& list, FreeBlock* first, FreeBlock* last) noexcept
+    {
+        std::lock_guard<std::mutex> lock(list.mutex);
+        last->next = list.head;
+        list.head = first;
+    }
+
+    std::array<FreeList, kSizeClasses> m_lists;
+};
+
+}  // namespace internal
+
+/**
+ * @brief PoolAllocator is a stateless allocator backed by internal::BlockPool
+ * @note  Requests larger than BlockPool::kMaxBlockSize or with extended alignment go straight
+ *   to operator new. It is meant for small, short-lived, frequently allocated objects, e.g.
+ *   the shared state of std::promise.
+ */
+template <typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept
+    {}
+
+    T* allocate(size_t n)
+    {
+        if (internal::BlockPool::IsPooled(n * sizeof(T), alignof(T)))
+            return static_cast<T*>(internal::BlockPool::Instance().Allocate(n * sizeof(T)));
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignof(T)}));
+        else
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        if (internal::BlockPool::IsPooled(n * sizeof(T), alignof(T)))
+            internal::BlockPool::Instance().Deallocate(p, n * sizeof(T));
+        else if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(p, std::align_val_t{alignof(T)});
+        else
+            ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
+
+}  // namespace cppbase
@@ -0,0 +1,233 @@
+/**************************************************************************
+ * @file:  SPSCQueue.h
+ * @brief: Bounded wait-free single-producer single-consumer ring buffer
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <thread>
+
+#include "Futex.h"
+
+namespace cppbase {
+
+/**
+ * @brief SPSCQueue replaces BlockingQueue when exactly one thread pushes and one thread pops
+ * @note  Push and pop only publish their index with a release store and read the other side's
+ *   index with an acquire load, which is cached so that it's only re-read when the queue looks
+ *   full or empty. With blocking enabled, a consumer that finds the queue empty sleeps on a
+ *   futex and the producer wakes it, otherwise Pop spins and yields. A full queue makes
+ *   TryPush fail and Push yield until there is room.
+ *   The capacity is rounded up to a power of two. T must be default constructible and move
+ *   assignable.
+ */
+template <typename T>
+class SPSCQueue
+{
+public:
+    explicit SPSCQueue(size_t capacity, bool blocking = true) : m_blocking(blocking)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        m_mask = size - 1;
+        m_buffer = std::make_unique<T[]>(size);
+    }
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    // producer side
+
+    bool TryPush(const T& data) { return TryPushImpl(data); }
+    bool TryPush(T&& data) { return TryPushImpl(std::move(data)); }
+
+    void Push(const T& data)
+    {
+        while (!TryPushImpl(data))
+            std::this_thread::yield();
+    }
+
+    void Push(T&& data)
+    {
+        while (!TryPushImpl(std::move(data)))
+            std::this_thread::yield();
+    }
+
+    /**
+     * @brief Move up to count values from [first, first + count) into the queue
+     * @return the number of values pushed, less than count if the queue is full
+     */
+    template <typename ForwardIt>
+    size_t PushN(ForwardIt first, size_t count)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t free = Capacity() - (tail - m_head_cache);
+        if (free < count)
+        {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            free = Capacity() - (tail - m_head_cache);
+        }
+        size_t n = std::min(count, free);
+        if (n == 0)
+            return 0;
+
+        // at most two contiguous spans, before and after the end of the buffer
+        size_t index = tail & m_mask;
+        size_t span = std::min(n, Capacity() - index);
+        auto middle = std::next(first, span);
+        std::move(first, middle, m_buffer.get() + index);
+        std::move(middle, std::next(middle, n - span), m_buffer.get());
+        Publish(tail + n);
+        return n;
+    }
+
+    // consumer side
+
+    /**
+     * @brief Pop a value, waiting while the queue is empty
+     */
+    void Pop(T& data)
+    {
+        while (!TryPop(data))
+            WaitNotEmpty(std::chrono::nanoseconds::max());
+    }
+
+    bool TryPop(T& value, int32_t timeout_ms = 0)
+    {
+        return PopN(&value, 1, timeout_ms) == 1;
+    }
+
+    /**
+     * @brief Move up to max_count values to out
+     * @param timeout_ms How long to wait if the queue is empty
+     * @return the number of values popped
+     */
+    template <typename OutputIt>
+    size_t PopN(OutputIt out, size_t max_count, int32_t timeout_ms = 0)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t available = m_tail_cache - head;
+        if (available == 0)
+        {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            available = m_tail_cache - head;
+            if (available == 0 && timeout_ms > 0)
+            {
+                auto deadline = std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(timeout_ms);
+                while (available == 0)
+                {
+                    auto now = std::chrono::steady_clock::now();
+                    if (now >= deadline)
+                        return 0;
+                    WaitNotEmpty(deadline - now);
+                    m_tail_cache = m_tail.load(std::memory_order_acquire);
+                    available = m_tail_cache - head;
+                }
+            }
+        }
+        size_t n = std::min(max_count, available);
+        if (n == 0)
+            return 0;
+
+        size_t index = head & m_mask;
+        size_t span = std::min(n, Capacity() - index);
+        auto* buffer = m_buffer.get();
+        out = std::move(buffer + index, buffer + index + span, out);
+        std::move(buffer, buffer + (n - span), out);
+        m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // either side, exact only for the thread that doesn't race with the other index
+
+    bool Empty() const { return Size() == 0; }
+
+    size_t Size() const
+    {
+        auto head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+
+    size_t Capacity() const { return m_mask + 1; }
+
+private:
+    enum : uint32_t
+    {
+        kAwake = 0,
+        kSleeping = 1,
+    };
+
+    template <typename U>
+    bool TryPushImpl(U&& data)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache == Capacity())
+        {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache == Capacity())
+                return false;
+        }
+        m_buffer[tail & m_mask] = std::forward<U>(data);
+        Publish(tail + 1);
+        return true;
+    }
+
+    void Publish(size_t tail)
+    {
+        m_tail.store(tail, std::memory_order_release);
+        if (m_blocking)
+        {
+            // pairs with the fence in WaitNotEmpty, either the consumer sees the new tail or
+            // the producer sees that the consumer is going to sleep
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_state.load(std::memory_order_relaxed) == kSleeping &&
+                m_state.exchange(kAwake) == kSleeping)
+                Futex::Wake(m_state);
+        }
+    }
+
+    void WaitNotEmpty(std::chrono::nanoseconds timeout)
+    {
+        if (!m_blocking)
+        {
+            std::this_thread::yield();
+            return;
+        }
+        m_state.store(kSleeping, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_tail.load(std::memory_order_relaxed) == m_head.load(std::memory_order_relaxed))
+        {
+            if (timeout == std::chrono::nanoseconds::max())
+                Futex::Wait(m_state, kSleeping);
+            else
+                Futex::WaitFor(m_state, kSleeping, timeout);
+        }
+        m_state.store(kAwake, std::memory_order_relaxed);
+    }
+
+    static constexpr size_t kCacheLine = 64;
+
+    // written by the consumer
+    alignas(kCacheLine) std::atomic<size_t> m_head{0};
+    size_t m_tail_cache{0};
+    std::atomic<uint32_t> m_state{kAwake};
+    // written by the producer
+    alignas(kCacheLine) std::atomic<size_t> m_tail{0};
+    size_t m_head_cache{0};
+    // read-only after construction
+    alignas(kCacheLine) std::unique_ptr<T[]> m_buffer;
+    size_t m_mask{0};
+    bool m_blocking;
+};
+
+}  // namespace cppbase
@@ -7,61 +7,124 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
-#include <mutex>
+#include <cstdint>
+
+#include "Futex.h"
 
 namespace cppbase {
 
+/**
+ * @brief Counting semaphore
+ * @note  The count lives in an atomic word. Notify and Wait only use atomic operations while
+ *   the count is positive or nobody is waiting, threads that have to wait sleep on a futex.
+ */
 class Semaphore
 {
 public:
-    Semaphore(int32_t count = 0) : m_count(count) {}
+    Semaphore(int32_t count = 0) : m_count(static_cast<uint32_t>(count)) {}
 
     ~Semaphore() { Reset(); }
 
-    void Notify()
+    void Notify() { Notify(1); }
+
+    /**
+     * @brief Increase the count by n and wake up to n waiting threads
+     */
+    void Notify(uint32_t n)
     {
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            m_count++;
-        }
-        // notify the waiting thread
-        m_cv.notify_one();
+        if (n == 0)
+            return;
+        // Waiters only sleep while the count is 0, so only the transition from 0 has to wake
+        // anyone. A woken waiter passes the wakeup on if it leaves a positive count behind.
+        // seq_cst orders the increment with the load of m_waiters, see Wait().
+        if (m_count.fetch_add(n) == 0 && m_waiters.load() > 0)
+            Futex::Wake(m_count, n);
     }
+
     void Wait()
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        while (m_count == 0)
-        {
-            // wait on the mutex until notify is called
-            m_cv.wait(lock);
-        }
-        m_count--;
+        if (TryDecrement())
+            return;
+
+        m_waiters.fetch_add(1);
+        while (!TryDecrement())
+            Futex::Wait(m_count, 0);
+        WakeNext();
+        m_waiters.fetch_sub(1);
     }
+
+    /**
+     * @brief Wait until the count is positive or the timeout expires
+     * @return false if the timeout expired
+     */
     bool TryWait(std::chrono::microseconds timeout /*us*/)
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        while (m_count == 0)
+        return TryWaitUntil(std::chrono::steady_clock::now() + timeout);
+    }
+
+    /**
+     * @brief Wait until the count is positive or the deadline passes
+     * @return false if the deadline passed
+     */
+    template <typename Clock, typename Duration>
+    bool TryWaitUntil(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        if (TryDecrement())
+            return true;
+
+        bool acquired = false;
+        m_waiters.fetch_add(1);
+        for (;;)
         {
-            m_cv.wait_for(lock, timeout);
-            if (m_count == 0)
-                return false;
+            if (TryDecrement())
+            {
+                WakeNext();
+                acquired = true;
+                break;
+            }
+            // a spurious wakeup only waits for the time that is left
+            auto remaining = deadline - Clock::now();
+            if (remaining <= Duration::zero())
+                break;
+            Futex::WaitFor(m_count, 0,
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
         }
-        m_count--;
-        return true;
+        m_waiters.fetch_sub(1);
+        return acquired;
     }
 
+    int32_t GetCount() const { return static_cast<int32_t>(m_count.load()); }
+
     void Reset()
     {
-        m_cv.notify_all();
         m_count = 0;
+        Futex::WakeAll(m_count);
     }
 
 private:
-    std::mutex m_mutex;
-    std::condition_variable m_cv;
-    int32_t m_count;
+    bool TryDecrement()
+    {
+        auto count = m_count.load();
+        while (count > 0)
+        {
+            if (m_count.compare_exchange_weak(count, count - 1))
+                return true;
+        }
+        return false;
+    }
+
+    // called by a waiter that has decremented the count and is still counted in m_waiters
+    void WakeNext()
+    {
+        if (m_count.load() > 0 && m_waiters.load() > 1)
+            Futex::Wake(m_count, 1);
+    }
+
+    // m_count is the futex word, waiters sleep while it is 0
+    std::atomic<uint32_t> m_count;
+    std::atomic<uint32_t> m_waiters{0};
 };
 
 }  // namespace cppbase
@@ -0,0 +1,207 @@
+/**************************************************************************
+ * @file:  Task.h
+ * @brief: Move-only type-erased callable with small buffer optimization
+ *         and a ring buffer queue for tasks.
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ *************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cppbase {
+
+/**
+ * @brief Task is a move-only replacement of std::function<void()>
+ * @note  Callables up to kInlineSize bytes that are nothrow move constructible are stored
+ *   inline, so wrapping a typical lambda doesn't allocate. Larger callables fall back to
+ *   the heap.
+ */
+class Task
+{
+public:
+    static constexpr size_t kInlineSize = 64;
+
+    template <typename F>
+    static constexpr bool IsInline()
+    {
+        using Func = std::decay_t<F>;
+        return sizeof(Func) <= kInlineSize && alignof(Func) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Func>;
+    }
+
+    Task() noexcept = default;
+
+    template <typename F,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task> &&
+                                          std::is_invocable_v<std::decay_t<F>&>>>
+    Task(F&& f)
+    {
+        using Func = std::decay_t<F>;
+        if constexpr (IsInline<F>())
+        {
+            new (&m_storage) Func(std::forward<F>(f));
+            m_ops = &InlineOps<Func>::ops;
+        } else
+        {
+            *reinterpret_cast<Func**>(&m_storage) = new Func(std::forward<F>(f));
+            m_ops = &HeapOps<Func>::ops;
+        }
+    }
+
+    Task(Task&& other) noexcept { MoveFrom(other); }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { Reset(); }
+
+    explicit operator bool() const noexcept { return m_ops != nullptr; }
+
+    void operator()() { m_ops->invoke(&m_storage); }
+
+    void Reset() noexcept
+    {
+        if (m_ops)
+        {
+            m_ops->destroy(&m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename Func>
+    struct InlineOps
+    {
+        static void Invoke(void* storage) { (*static_cast<Func*>(storage))(); }
+        static void Move(void* dst, void* src) noexcept
+        {
+            new (dst) Func(std::move(*static_cast<Func*>(src)));
+            static_cast<Func*>(src)->~Func();
+        }
+        static void Destroy(void* storage) noexcept { static_cast<Func*>(storage)->~Func(); }
+        static constexpr Ops ops{&Invoke, &Move, &Destroy};
+    };
+
+    template <typename Func>
+    struct HeapOps
+    {
+        static void Invoke(void* storage) { (**static_cast<Func**>(storage))(); }
+        static void Move(void* dst, void* src) noexcept
+        {
+            *static_cast<Func**>(dst) = *static_cast<Func**>(src);
+        }
+        static void Destroy(void* storage) noexcept { delete *static_cast<Func**>(storage); }
+        static constexpr Ops ops{&Invoke, &Move, &Destroy};
+    };
+
+    void MoveFrom(Task& other) noexcept
+    {
+        if (other.m_ops)
+        {
+            other.m_ops->move(&m_storage, &other.m_storage);
+            m_ops = other.m_ops;
+            other.m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[kInlineSize];
+    const Ops* m_ops{nullptr};
+};
+
+/**
+ * @brief RingQueue is a double ended queue backed by a ring buffer
+ * @note  The buffer grows by doubling and is never shrunk, so a queue that has reached its
+ *   working size no longer allocates. It is not thread-safe. T must be default constructible
+ *   and move assignable.
+ */
+template <typename T>
+class RingQueue
+{
+public:
+    RingQueue() = default;
+    RingQueue(const RingQueue&) = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+
+    bool Empty() const { return m_size == 0; }
+    size_t Size() const { return m_size; }
+    size_t Capacity() const { return m_capacity; }
+
+    void Reserve(size_t capacity)
+    {
+        if (capacity > m_capacity)
+        {
+            size_t new_capacity = m_capacity ? m_capacity : 16;
+            while (new_capacity < capacity)
+                new_capacity *= 2;
+            Reallocate(new_capacity);
+        }
+    }
+
+    void Push(T&& value)
+    {
+        if (m_size == m_capacity)
+            Reserve(m_size + 1);
+        m_buffer[(m_head + m_size) & (m_capacity - 1)] = std::move(value);
+        ++m_size;
+    }
+
+    T& Front() { return m_buffer[m_head]; }
+    T& Back() { return m_buffer[(m_head + m_size - 1) & (m_capacity - 1)]; }
+
+    T PopFront()
+    {
+        T value = std::move(m_buffer[m_head]);
+        m_head = (m_head + 1) & (m_capacity - 1);
+        --m_size;
+        return value;
+    }
+
+    T PopBack()
+    {
+        --m_size;
+        return std::move(m_buffer[(m_head + m_size) & (m_capacity - 1)]);
+    }
+
+private:
+    void Reallocate(size_t capacity)
+    {
+        auto buffer = std::make_unique<T[]>(capacity);
+        for (size_t i = 0; i < m_size; ++i)
+            buffer[i] = std::move(m_buffer[(m_head + i) & (m_capacity - 1)]);
+        m_buffer = std::move(buffer);
+        m_capacity = capacity;
+        m_head = 0;
+    }
+
+    std::unique_ptr<T[]> m_buffer;
+    size_t m_capacity{0};  // always zero or a power of two
+    size_t m_head{0};
+    size_t m_size{0};
+};
+
+using TaskQueue = RingQueue<Task>;
+
+}  // namespace cppbase
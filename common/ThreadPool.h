@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
@@ -14,12 +17,15 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <stdexcept>
 #include <thread>
+#include <tuple>
 #include <vector>
 
+#include "CpuTopology.h"
 #include "Global.h"
+#include "PoolAllocator.h"
+#include "Task.h"
 
 namespace cppbase {
 
@@ -33,17 +39,250 @@ enum class ThreadPriority : int32_t
 };
 
 /**
- * @brief SetThreadPriority
+ * @brief Priority of an individual task, see ThreadPool::Enqueue(TaskPriority, ...)
+ */
+enum class TaskPriority : int32_t
+{
+    LOW = 0,
+    NORMAL = 1,
+    HIGH = 2,
+    CRITICAL = 3,
+};
+
+/**
+ * @brief Order in which the per-priority ready queues are drained
+ *   STRICT   - always run the highest priority task available
+ *   WEIGHTED - serve the priorities in proportion to ThreadPoolOptions::priority_weights
+ * @note  With either policy, a non-empty queue that has been passed over for longer than
+ *   ThreadPoolOptions::starvation_threshold gets the next worker.
+ */
+enum class DrainPolicy : int32_t
+{
+    STRICT = 0,
+    WEIGHTED = 1,
+};
+
+/**
+ * @brief How tasks are distributed among the workers of a ThreadPool
+ *   SINGLE_QUEUE  - all workers share one FIFO queue guarded by one mutex
+ *   WORK_STEALING - every worker owns a deque. Tasks enqueued from a worker are pushed to
+ *                   its own deque and popped LIFO, idle workers steal FIFO from the others,
+ *                   and tasks enqueued from non-pool threads go to a shared injection queue.
+ */
+enum class SchedulingPolicy : int32_t
+{
+    SINGLE_QUEUE = 0,
+    WORK_STEALING = 1,
+};
+
+/**
+ * @brief Elastic sizing of a ThreadPool
+ * @note  The pool starts with the thread count passed to the constructor, clamped to
+ *   [min_threads, max_threads]. A worker is added whenever the oldest queued task has waited
+ *   longer than scale_up_wait, and a worker that found no task for idle_timeout retires as
+ *   long as more than min_threads workers are left.
+ */
+struct ElasticOptions
+{
+    bool enabled{false};
+    uint32_t min_threads{1};
+    // zero for max(threads, std::thread::hardware_concurrency())
+    uint32_t max_threads{0};
+    std::chrono::microseconds scale_up_wait{std::chrono::milliseconds(1)};
+    std::chrono::milliseconds idle_timeout{std::chrono::seconds(5)};
+};
+
+/**
+ * @brief Optional ThreadPool settings
+ */
+struct ThreadPoolOptions
+{
+    SchedulingPolicy scheduling{SchedulingPolicy::SINGLE_QUEUE};
+    // collect ThreadPoolMetrics from the start, can also be toggled with EnableMetrics()
+    bool enable_metrics{false};
+    DrainPolicy drain_policy{DrainPolicy::STRICT};
+    // relative share of LOW, NORMAL, HIGH and CRITICAL tasks for DrainPolicy::WEIGHTED
+    std::array<uint32_t, 4> priority_weights{1, 2, 4, 8};
+    // starvation protection, zero disables it
+    std::chrono::microseconds starvation_threshold{std::chrono::milliseconds(50)};
+    // topology aware worker placement, overrides cpu_reserved unless the policy is NONE
+    ThreadPlacement placement;
+    ElasticOptions elastic;
+};
+
+/**
+ * @brief Snapshot of ThreadPool metrics since metrics were enabled or last reset
+ * @note  Queue wait is the time from Enqueue/Post until a worker dequeues the task, run time is
+ *   the time the worker spends executing it. A worker is busy while it runs tasks.
+ */
+struct ThreadPoolMetrics
+{
+    struct Worker
+    {
+        uint64_t tasks{0};
+        double busy_ratio{0};  // busy time / elapsed time, idle ratio is 1 - busy_ratio
+        double tasks_per_sec{0};
+        double avg_wait_us{0};
+        double max_wait_us{0};
+        double avg_run_us{0};
+        double max_run_us{0};
+    };
+
+    double elapsed_s{0};
+    uint64_t tasks{0};
+    double tasks_per_sec{0};
+    double avg_wait_us{0};
+    double max_wait_us{0};
+    double avg_run_us{0};
+    double max_run_us{0};
+    uint64_t queue_depth{0};
+    uint64_t queue_depth_high_water{0};
+    std::vector<Worker> workers;
+};
+
+/**
+ * @brief Set the OS scheduling priority of the calling thread
+ * @note  On Linux, CRITICAL maps to SCHED_FIFO and HIGH to SCHED_RR with the enum value as
+ *   the real-time priority, LOW to nice 10 and IDLE to SCHED_IDLE. NORMAL leaves the thread
+ *   unchanged. Without CAP_SYS_NICE the real-time policies fall back to a negative nice value,
+ *   and failing that the thread keeps its current priority.
  * @param priority
+ * @return 0 if the requested priority was applied, otherwise the error code of the failure
  */
 int32_t SetThreadPriority(ThreadPriority priority);
 
 /**
- * @brief GetThreadPriority
- * @param id
+ * @brief Get the real-time scheduling priority of a thread
+ * @param id Native thread handle
+ * @return sched_priority of the thread, 0 for non real-time threads
  */
 int32_t GetThreadPriority(int64_t id);
 
+namespace internal {
+
+/**
+ * @brief ReadyQueues keeps one FIFO queue per TaskPriority and selects the queue to serve next
+ *   according to the DrainPolicy and starvation threshold. It is not thread-safe.
+ */
+template <typename T>
+class ReadyQueues
+{
+public:
+    static constexpr size_t kLevels = 4;
+
+    void Configure(DrainPolicy policy, const std::array<uint32_t, kLevels>& weights,
+                   int64_t starvation_ns)
+    {
+        m_policy = policy;
+        for (size_t i = 0; i < kLevels; ++i)
+            m_weights[i] = std::max(weights[i], 1u);
+        m_credits = m_weights;
+        m_starvation_ns = starvation_ns;
+    }
+
+    bool Empty() const { return m_size == 0; }
+    size_t Size() const { return m_size; }
+
+    void Push(TaskPriority priority, T&& value)
+    {
+        m_queues[static_cast<size_t>(priority)].Push(std::move(value));
+        ++m_size;
+    }
+
+    /**
+     * @brief Pop the next value, the queues must not be empty
+     * @param now Current time in ns, only called if several priorities are waiting
+     * @return the priority of the popped value
+     */
+    template <typename Clock>
+    TaskPriority Pop(T& value, Clock&& now)
+    {
+        size_t level = Select(now);
+        value = m_queues[level].PopFront();
+        --m_size;
+        // the level is no longer passed over once it has been served
+        m_bypassed_since[level] = 0;
+        return static_cast<TaskPriority>(level);
+    }
+
+    /**
+     * @brief Call f with the oldest value of every non-empty priority
+     */
+    template <typename F>
+    void ForEachFront(F&& f)
+    {
+        for (auto& queue : m_queues)
+        {
+            if (!queue.Empty())
+                f(queue.Front());
+        }
+    }
+
+private:
+    template <typename Clock>
+    size_t Select(Clock&& now)
+    {
+        size_t highest = kLevels;
+        size_t waiting = 0;
+        for (size_t level = kLevels; level-- > 0;)
+        {
+            if (!m_queues[level].Empty())
+            {
+                if (highest == kLevels)
+                    highest = level;
+                ++waiting;
+            } else
+            {
+                m_bypassed_since[level] = 0;
+            }
+        }
+        if (waiting == 1)
+            return highest;
+
+        if (m_starvation_ns > 0)
+        {
+            int64_t time = now();
+            for (size_t level = 0; level < highest; ++level)
+            {
+                if (m_queues[level].Empty())
+                    continue;
+                if (m_bypassed_since[level] == 0)
+                    m_bypassed_since[level] = time;
+                else if (time - m_bypassed_since[level] >= m_starvation_ns)
+                    return level;
+            }
+        }
+
+        if (m_policy == DrainPolicy::WEIGHTED)
+        {
+            // deficit round robin, refill the credits once every waiting level used its share
+            for (int32_t pass = 0; pass < 2; ++pass)
+            {
+                for (size_t level = kLevels; level-- > 0;)
+                {
+                    if (!m_queues[level].Empty() && m_credits[level] > 0)
+                    {
+                        --m_credits[level];
+                        return level;
+                    }
+                }
+                m_credits = m_weights;
+            }
+        }
+        return highest;
+    }
+
+    std::array<RingQueue<T>, kLevels> m_queues;
+    std::array<int64_t, kLevels> m_bypassed_since{};
+    std::array<uint32_t, kLevels> m_weights{1, 1, 1, 1};
+    std::array<uint32_t, kLevels> m_credits{1, 1, 1, 1};
+    DrainPolicy m_policy{DrainPolicy::STRICT};
+    int64_t m_starvation_ns{0};
+    size_t m_size{0};
+};
+
+}  // namespace internal
+
 class ThreadPool
 {
 public:
@@ -56,59 +295,219 @@ public:
      *        e.g. The CPU has 4 cores, and threads = 4, cpu_reserved = 1, then
      *        the thread affinity for the 4 threads in the thread pool will be
      *        set to CPU1, CPU2, CPU3, CPU1, and CPU0 is not used.
+     * @param options Optional settings, e.g. the scheduling policy
+     * @note  In elastic mode threads is the initial number of workers, the priority and the
+     *   CPU placement also apply to the workers added later.
      */
-    explicit ThreadPool(uint32_t threads, ThreadPriority priority, uint32_t cpu_reserved = 0);
+    explicit ThreadPool(uint32_t threads, ThreadPriority priority, uint32_t cpu_reserved = 0,
+                        const ThreadPoolOptions& options = {});
     ThreadPool() = delete;
     ~ThreadPool();
 
+    /**
+     * @brief Enqueue a task and get a future for its result
+     * @note  The promise/future shared state is pooled, and the task is stored inline if its
+     *   captures are small enough, so steady-state submission doesn't allocate.
+     */
     template <class F, class... Args>
     auto Enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type>;
 
+    /**
+     * @brief Enqueue a task with the given priority
+     * @note  In work-stealing mode only NORMAL tasks spawned by a worker go to the worker's own
+     *   deque, all other tasks go through the shared ready queues. Workers check for HIGH and
+     *   CRITICAL tasks before looking at their own deques.
+     */
+    template <class F, class... Args>
+    auto Enqueue(TaskPriority priority, F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type>;
+
+    /**
+     * @brief Enqueue a fire-and-forget task
+     * @note  No future is created. Exceptions thrown by the task are logged and dropped.
+     */
+    template <class F, class... Args,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, TaskPriority>>>
+    void Post(F&& f, Args&&... args);
+
+    template <class F, class... Args>
+    void Post(TaskPriority priority, F&& f, Args&&... args);
+
     ThreadPriority GetThreadPriority() const;
     uint32_t GetReservedCpu() const;
+    SchedulingPolicy GetSchedulingPolicy() const;
+
+    /**
+     * @brief Get the current number of workers, only changes in elastic mode
+     */
+    uint32_t GetThreadCount() const;
+
+    /**
+     * @brief Get the CPUs each worker slot is pinned to, empty if the worker has no affinity
+     * @note  In elastic mode there is one slot for each of the max_threads possible workers.
+     */
+    const std::vector<std::vector<uint32_t> >& GetWorkerCpus() const;
+
+    /**
+     * @brief Enable or disable metrics collection. Enabling resets the collected metrics.
+     * @note  When disabled the hot path only pays for one relaxed atomic load per task.
+     */
+    void EnableMetrics(bool enable);
+    bool IsMetricsEnabled() const;
+    void ResetMetrics();
+    ThreadPoolMetrics GetMetrics() const;
+
+    /**
+     * @brief Periodically log a metrics summary through the module logger
+     * @param interval Logging interval, zero stops logging
+     */
+    void SetMetricsLogInterval(std::chrono::milliseconds interval);
 
 private:
-    // need to keep track of threads so we can join them
+    // a queued task and the steady clock time it was queued at in ns, 0 if metrics are off
+    struct QueuedTask
+    {
+        Task task;
+        int64_t enqueue_time{0};
+    };
+
+    // per-worker metrics counters, only written by the owning worker
+    struct alignas(64) WorkerCounters
+    {
+        std::atomic<uint64_t> tasks{0};
+        std::atomic<uint64_t> wait_ns{0};
+        std::atomic<uint64_t> max_wait_ns{0};
+        std::atomic<uint64_t> run_ns{0};
+        std::atomic<uint64_t> max_run_ns{0};
+    };
+
+    // per-worker state for SchedulingPolicy::WORK_STEALING, aligned to avoid false sharing
+    struct alignas(64) Worker
+    {
+        std::mutex mutex;
+        RingQueue<QueuedTask> tasks;
+    };
+
+    // the calling thread's worker index if it belongs to this pool, otherwise -1
+    int32_t CurrentWorkerIndex() const;
+
+    static int64_t Now();
+    void UpdateQueueDepth(size_t depth);
+    void Push(Task&& task, TaskPriority priority = TaskPriority::NORMAL);
+    void StartWorker(uint32_t index);
+    // wait on m_condition until ready() holds, false if the worker should retire instead
+    template <typename Predicate>
+    bool WaitForWork(std::unique_lock<std::mutex>& lock, uint32_t index, Predicate ready);
+    // enqueue time of the oldest queued task, 0 if no task is queued
+    int64_t OldestEnqueueTime();
+    void AddWorker();
+    void ElasticLoop();
+    bool TryPopShared(QueuedTask& entry);
+    void RunTask(uint32_t index, QueuedTask& entry) noexcept;
+    void WorkerLoop(uint32_t index);
+    void WorkStealingLoop(uint32_t index);
+    bool TryPopTask(uint32_t index, QueuedTask& entry);
+    void MetricsLogLoop();
+
+    // need to keep track of threads so we can join them, one slot per possible worker
     std::vector<std::thread> m_threads;
-    // the task queue
-    std::queue<std::function<void()> > m_tasks;
+    // slots with a running worker, guarded by m_queue_mutex
+    std::vector<bool> m_active;
+    std::atomic<uint32_t> m_thread_count{0};
+    std::vector<std::vector<uint32_t> > m_worker_cpus;
+    // the per-priority task queues, also serve as the injection queues for non-pool threads
+    // in work-stealing mode
+    internal::ReadyQueues<QueuedTask> m_tasks;
+    std::vector<std::unique_ptr<Worker> > m_workers;
 
     // synchronization
-    std::mutex m_queue_mutex;
+    mutable std::mutex m_queue_mutex;
     std::condition_variable m_condition;
-    bool m_stop{false};
+    std::atomic<bool> m_stop{false};
+    // number of queued tasks (all queues / injection queue only) and sleeping workers,
+    // only used in work-stealing mode
+    std::atomic<size_t> m_pending{0};
+    std::atomic<size_t> m_injected{0};
+    // number of HIGH and CRITICAL tasks in the shared queues
+    std::atomic<size_t> m_urgent{0};
+    std::atomic<uint32_t> m_sleeping{0};
     ThreadPriority m_priority;
     uint32_t m_cpu_reserved{0};
+    ThreadPoolOptions m_options;
+
+    // elastic sizing
+    std::thread m_elastic_thread;
+    std::mutex m_elastic_mutex;
+    std::condition_variable m_elastic_condition;
+
+    // metrics
+    std::atomic<bool> m_metrics_enabled{false};
+    std::atomic<int64_t> m_metrics_start{0};
+    std::atomic<uint64_t> m_queue_depth_high_water{0};
+    std::vector<WorkerCounters> m_counters;
+    std::thread m_metrics_thread;
+    std::mutex m_metrics_mutex;
+    std::condition_variable m_metrics_condition;
+    std::chrono::milliseconds m_metrics_interval{0};
 };
 
 // add new work item to the pool
 template <class F, class... Args>
 auto ThreadPool::Enqueue(F&& f, Args&&... args)
     -> std::future<typename std::result_of<F(Args...)>::type>
+{
+    return Enqueue(TaskPriority::NORMAL, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template <class F, class... Args>
+auto ThreadPool::Enqueue(TaskPriority priority, F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type>
 {
     using return_type = typename std::result_of<F(Args...)>::type;
 
-    auto task = std::make_shared<std::packaged_task<return_type()> >(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    std::promise<return_type> promise(std::allocator_arg, PoolAllocator<return_type>());
+    std::future<return_type> res = promise.get_future();
+    Task task([promise = std::move(promise), func = std::forward<F>(f),
+               params = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        try
+        {
+            if constexpr (std::is_void_v<return_type>)
+            {
+                std::apply(func, params);
+                promise.set_value();
+            } else
+            {
+                promise.set_value(std::apply(func, params));
+            }
+        } catch (...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+    });
+    Push(std::move(task), priority);
+    return res;
+}
 
-    std::future<return_type> res = task->get_future();
+template <class F, class... Args, typename>
+void ThreadPool::Post(F&& f, Args&&... args)
+{
+    Post(TaskPriority::NORMAL, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template <class F, class... Args>
+void ThreadPool::Post(TaskPriority priority, F&& f, Args&&... args)
+{
+    if constexpr (sizeof...(Args) == 0)
+    {
+        Push(std::forward<F>(f), priority);
+    } else
     {
-        std::unique_lock<std::mutex> lock(m_queue_mutex);
-
-        // don't allow enqueueing after stopping the pool
-        if (m_stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
-
-        m_tasks.emplace([task]() {
-            using namespace std::chrono;
-            auto start = high_resolution_clock::now();
-            (*task)();
-            auto stop = high_resolution_clock::now();
-            auto duration = duration_cast<microseconds>(stop - start);
+        Task task([func = std::forward<F>(f),
+                   params = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            std::apply(func, params);
         });
+        Push(std::move(task), priority);
     }
-    m_condition.notify_one();
-    return res;
 }
 
 }  // namespace cppbase
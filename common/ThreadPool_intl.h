@@ -9,66 +9,97 @@
 
 #include <logging/Logging.h>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
 namespace cppbase {
 
 static auto logger = logging::GetLoggerForCurrentModule();
 
-// #ifdef __linux__
-#if 0
-int32_t SetThreadPriority(ThreadPriority priority)
+#ifdef __linux__
+
+namespace internal {
+
+inline int32_t SetThreadNice(int32_t nice_value)
+{
+    auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, nice_value) != 0)
+        return errno;
+    return 0;
+}
+
+}  // namespace internal
+
+inline int32_t SetThreadPriority(ThreadPriority priority)
 {
     pthread_t id = pthread_self();
-    int policy;
+    int32_t pri = static_cast<int32_t>(priority);
     struct sched_param sp;
-    int pri = static_cast<int>(priority);
-
-    int rv = pthread_getschedparam(id, &policy, &sp);
-    if (rv != 0)
-        return rv;
+    sp.sched_priority = 0;
 
-    olog_info("ThreadUtils", "thread {}, policy: {}, priority: {}, new priority: {}",
-              id, policy, sp.sched_priority, pri);
+    switch (priority)
+    {
+    case ThreadPriority::IDLE:
+        return pthread_setschedparam(id, SCHED_IDLE, &sp);
+    case ThreadPriority::LOW:
+        return internal::SetThreadNice(10);
+    case ThreadPriority::NORMAL:
+        return 0;
+    default:
+        break;
+    }
 
-    if (sp.sched_priority == pri && policy == SCHED_RR)
+    int policy = priority == ThreadPriority::CRITICAL ? SCHED_FIFO : SCHED_RR;
+    sp.sched_priority =
+        std::clamp(pri, sched_get_priority_min(policy), sched_get_priority_max(policy));
+    int rv = pthread_setschedparam(id, policy, &sp);
+    if (rv == 0)
         return 0;
 
-    int priority_max = sched_get_priority_max(SCHED_RR);
-    pri = std::min(pri, priority_max);
-    sp.sched_priority = pri;
-    rv = pthread_setschedparam(pthread_self(), SCHED_RR, &sp);
-    if (rv != 0)
+    // Real-time policies need CAP_SYS_NICE (or RLIMIT_RTPRIO), fall back to a higher nice
+    // priority, which is allowed up to RLIMIT_NICE, and otherwise keep running as is.
+    static std::atomic<bool> warned{false};
+    int32_t nice_value = priority == ThreadPriority::CRITICAL ? -10 : -5;
+    int32_t nice_rv = internal::SetThreadNice(nice_value);
+    if (!warned.exchange(true))
     {
-        olog_warning("ThreadUtils", "warning: sched_rr set fail: {}", strerror(errno));
-        return rv;
+        if (nice_rv == 0)
+            logger->warn("Unable to set {} priority {}: {}, using nice {} instead",
+                         policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR", sp.sched_priority,
+                         strerror(rv), nice_value);
+        else
+            logger->warn("Unable to raise thread priority: {}, keeping the default priority",
+                         strerror(rv));
     }
-    else
-    {
-        pthread_getschedparam(pthread_self(), &policy, &sp);
-        olog_info("ThreadUtils", "thread {}, new policy: {}, priority is: {}", id, policy,
-                  sp.sched_priority);
-    }
-
-    return 0;
+    return rv;
 }
 
-int32_t GetThreadPriority(int64_t id)
+inline int32_t GetThreadPriority(int64_t id)
 {
     int policy;
     struct sched_param sp;
-    int rv = pthread_getschedparam(id, &policy, &sp);
+    int rv = pthread_getschedparam(static_cast<pthread_t>(id), &policy, &sp);
     if (rv != 0)
-        throw InternalErrorException("Error getting thread sched param");
+        throw std::runtime_error("Error getting thread sched param");
     return sp.sched_priority;
 }
 
 #else
 
-int32_t SetThreadPriority(ThreadPriority)
+inline int32_t SetThreadPriority(ThreadPriority)
 {
     return 0;
 }
 
-int32_t GetThreadPriority(int64_t)
+inline int32_t GetThreadPriority(int64_t)
 {
     return 0;
 }
@@ -76,71 +107,591 @@ int32_t GetThreadPriority(int64_t)
 #endif
 
 // the constructor just launches some amount of workers
-ThreadPool::ThreadPool(uint32_t threads, ThreadPriority priority, uint32_t cpu_reserved)
-    : m_priority(priority), m_cpu_reserved(cpu_reserved)
+inline ThreadPool::ThreadPool(uint32_t threads, ThreadPriority priority, uint32_t cpu_reserved,
+                       const ThreadPoolOptions& options)
+    : m_priority(priority), m_cpu_reserved(cpu_reserved), m_options(options)
 {
     static uint32_t cpu_nums = std::thread::hardware_concurrency();
-    auto set_affinity = [&](uint32_t index, std::thread& thread) {
+
+    // the pool has a slot per possible worker, all but the first threads stay empty unless
+    // the pool is elastic
+    uint32_t slots = threads;
+    auto& elastic = m_options.elastic;
+    if (elastic.enabled)
+    {
+        if (elastic.max_threads == 0)
+            elastic.max_threads = std::max(threads, cpu_nums);
+        elastic.min_threads = std::min(elastic.min_threads, elastic.max_threads);
+        threads = std::clamp(threads, elastic.min_threads, elastic.max_threads);
+        slots = elastic.max_threads;
+    }
+
+    if (m_options.placement.policy != PlacementPolicy::NONE)
+    {
+        m_worker_cpus = CpuTopology::Instance().Place(m_options.placement, slots);
+    } else
+    {
+        m_worker_cpus.resize(slots);
         if (cpu_reserved && cpu_reserved < cpu_nums)
         {
-#ifdef __linux__
-            uint32_t cpu_id = index % (cpu_nums - cpu_reserved);
-            cpu_set_t cpuset;
-            CPU_ZERO(&cpuset);
-            CPU_SET(cpu_id, &cpuset);
-            auto rc = pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuset);
-            if (rc != 0)
-            {
-                logger->error("Error calling pthread_setaffinity_np: {}", rc);
-            }
-#endif
+            for (uint32_t i = 0; i < slots; ++i)
+                m_worker_cpus[i] = {i % (cpu_nums - cpu_reserved)};
         }
-    };
+    }
+
+    m_tasks.Configure(m_options.drain_policy, m_options.priority_weights,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          m_options.starvation_threshold)
+                          .count());
+    m_counters = std::vector<WorkerCounters>(slots);
+    EnableMetrics(m_options.enable_metrics);
+
+    if (m_options.scheduling == SchedulingPolicy::WORK_STEALING)
+    {
+        // all deques must exist before any worker starts stealing
+        for (uint32_t i = 0; i < slots; ++i)
+            m_workers.emplace_back(std::make_unique<Worker>());
+    }
 
+    m_threads.resize(slots);
+    m_active.resize(slots, false);
     for (uint32_t i = 0; i < threads; ++i)
     {
-        m_threads.emplace_back([this, priority] {
-            SetThreadPriority(priority);
-            for (;;)
-            {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(m_queue_mutex);
-                    m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
-                    if (m_stop && m_tasks.empty())
-                        return;
-                    task = std::move(m_tasks.front());
-                    m_tasks.pop();
-                }
-                task();
-            }
-        });
-        set_affinity(i, m_threads[i]);
-    }
-    logger->info("Created thread pool with {} threads at priority {}, {} CPU core(s) reserved",
-                 threads, static_cast<int>(priority), cpu_reserved);
+        m_active[i] = true;
+        StartWorker(i);
+    }
+    m_thread_count = threads;
+
+    if (elastic.enabled)
+    {
+        m_elastic_thread = std::thread([this] { ElasticLoop(); });
+        logger->info("Created elastic thread pool with {} ({}-{}) threads at priority {}, {} CPU "
+                     "core(s) reserved",
+                     threads, elastic.min_threads, elastic.max_threads,
+                     static_cast<int>(priority), cpu_reserved);
+    } else
+    {
+        logger->info("Created thread pool with {} threads at priority {}, {} CPU core(s) reserved",
+                     threads, static_cast<int>(priority), cpu_reserved);
+    }
 }
 
 // the destructor joins all threads
-ThreadPool::~ThreadPool()
+inline ThreadPool::~ThreadPool()
 {
+    SetMetricsLogInterval(std::chrono::milliseconds(0));
     {
         std::unique_lock<std::mutex> lock(m_queue_mutex);
         m_stop = true;
     }
     m_condition.notify_all();
+    if (m_elastic_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_elastic_mutex);
+        }
+        m_elastic_condition.notify_all();
+        m_elastic_thread.join();
+    }
     for (std::thread& thread : m_threads)
-        thread.join();
+    {
+        // retired workers have left their loop already
+        if (thread.joinable())
+            thread.join();
+    }
 }
 
-ThreadPriority ThreadPool::GetThreadPriority() const
+inline ThreadPriority ThreadPool::GetThreadPriority() const
 {
     return m_priority;
 }
 
-uint32_t ThreadPool::GetReservedCpu() const
+inline uint32_t ThreadPool::GetReservedCpu() const
 {
     return m_cpu_reserved;
 }
 
+inline SchedulingPolicy ThreadPool::GetSchedulingPolicy() const
+{
+    return m_options.scheduling;
+}
+
+inline uint32_t ThreadPool::GetThreadCount() const
+{
+    return m_thread_count;
+}
+
+inline const std::vector<std::vector<uint32_t> >& ThreadPool::GetWorkerCpus() const
+{
+    return m_worker_cpus;
+}
+
+namespace internal {
+
+struct ThreadPoolWorkerContext
+{
+    const ThreadPool* pool{nullptr};
+    int32_t index{-1};
+};
+
+inline ThreadPoolWorkerContext& CurrentThreadPoolWorker()
+{
+    static thread_local ThreadPoolWorkerContext context;
+    return context;
+}
+
+}  // namespace internal
+
+inline int32_t ThreadPool::CurrentWorkerIndex() const
+{
+    const auto& context = internal::CurrentThreadPoolWorker();
+    return context.pool == this ? context.index : -1;
+}
+
+inline int64_t ThreadPool::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline void ThreadPool::UpdateQueueDepth(size_t depth)
+{
+    auto high_water = m_queue_depth_high_water.load(std::memory_order_relaxed);
+    while (depth > high_water &&
+           !m_queue_depth_high_water.compare_exchange_weak(high_water, depth,
+                                                           std::memory_order_relaxed))
+    {
+    }
+}
+
+inline void ThreadPool::StartWorker(uint32_t index)
+{
+    m_threads[index] = std::thread([this, index] {
+        SetThreadPriority(m_priority);
+        WorkerLoop(index);
+    });
+#ifdef __linux__
+    if (!m_worker_cpus[index].empty())
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (auto cpu_id : m_worker_cpus[index])
+            CPU_SET(cpu_id, &cpuset);
+        auto rc = pthread_setaffinity_np(m_threads[index].native_handle(), sizeof(cpu_set_t),
+                                         &cpuset);
+        if (rc != 0)
+        {
+            logger->error("Error calling pthread_setaffinity_np: {}", rc);
+        }
+    }
+#endif
+}
+
+template <typename Predicate>
+bool ThreadPool::WaitForWork(std::unique_lock<std::mutex>& lock, uint32_t index,
+                             Predicate ready)
+{
+    if (!m_options.elastic.enabled)
+    {
+        m_condition.wait(lock, ready);
+        return true;
+    }
+
+    while (!m_condition.wait_for(lock, m_options.elastic.idle_timeout, ready))
+    {
+        // no task for a whole idle timeout
+        if (m_thread_count > m_options.elastic.min_threads)
+        {
+            m_active[index] = false;
+            m_thread_count.fetch_sub(1);
+            logger->debug("Thread pool worker {} retired, {} threads left", index,
+                          m_thread_count.load());
+            return false;
+        }
+    }
+    return true;
+}
+
+inline int64_t ThreadPool::OldestEnqueueTime()
+{
+    int64_t oldest = 0;
+    auto visit = [&oldest](const QueuedTask& entry) {
+        if (entry.enqueue_time && (oldest == 0 || entry.enqueue_time < oldest))
+            oldest = entry.enqueue_time;
+    };
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_tasks.ForEachFront(visit);
+    }
+    // the front of a deque is its oldest task, the end thieves take from
+    for (auto& worker : m_workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (!worker->tasks.Empty())
+            visit(worker->tasks.Front());
+    }
+    return oldest;
+}
+
+inline void ThreadPool::AddWorker()
+{
+    uint32_t index = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        if (m_stop || m_thread_count >= m_options.elastic.max_threads)
+            return;
+        while (m_active[index])
+            ++index;
+        m_active[index] = true;
+        m_thread_count.fetch_add(1);
+    }
+    // a previous worker of the slot has already left its loop, reap it before reusing the slot
+    if (m_threads[index].joinable())
+        m_threads[index].join();
+    StartWorker(index);
+    logger->debug("Thread pool worker {} added, {} threads", index, m_thread_count.load());
+}
+
+inline void ThreadPool::ElasticLoop()
+{
+    auto scale_up_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(m_options.elastic.scale_up_wait)
+            .count();
+    // sample the queue twice per threshold so a stalled queue is noticed in time
+    auto interval = std::max<std::chrono::microseconds>(m_options.elastic.scale_up_wait / 2,
+                                                        std::chrono::microseconds(100));
+
+    std::unique_lock<std::mutex> lock(m_elastic_mutex);
+    while (!m_elastic_condition.wait_for(lock, interval, [this] { return m_stop.load(); }))
+    {
+        auto oldest = OldestEnqueueTime();
+        if (oldest && Now() - oldest >= scale_up_ns)
+            AddWorker();
+    }
+}
+
+inline void ThreadPool::Push(Task&& task, TaskPriority priority)
+{
+    bool metrics = m_metrics_enabled.load(std::memory_order_relaxed);
+    // elastic pools need the enqueue time to detect queueing delay
+    bool stamp = metrics || m_options.elastic.enabled;
+    QueuedTask entry{std::move(task), stamp ? Now() : 0};
+    size_t depth = 0;
+
+    if (m_options.scheduling == SchedulingPolicy::SINGLE_QUEUE)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_queue_mutex);
+
+            // don't allow enqueueing after stopping the pool
+            if (m_stop)
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+
+            m_tasks.Push(priority, std::move(entry));
+            depth = m_tasks.Size();
+        }
+        m_condition.notify_one();
+        if (metrics)
+            UpdateQueueDepth(depth);
+        return;
+    }
+
+    int32_t index = CurrentWorkerIndex();
+    if (index >= 0 && priority == TaskPriority::NORMAL)
+    {
+        // tasks spawned by a worker stay on the worker's own deque
+        auto& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.Push(std::move(entry));
+        depth = m_pending.fetch_add(1) + 1;
+    } else
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        if (m_stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        m_tasks.Push(priority, std::move(entry));
+        if (priority > TaskPriority::NORMAL)
+            m_urgent.fetch_add(1);
+        m_injected.fetch_add(1);
+        depth = m_pending.fetch_add(1) + 1;
+    }
+    if (metrics)
+        UpdateQueueDepth(depth);
+
+    // Only wake a worker if one is asleep. A worker registers itself in m_sleeping before it
+    // re-checks m_pending under m_queue_mutex, so taking the mutex here guarantees that the
+    // notification can't slip in between its check and its wait.
+    if (m_sleeping.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_queue_mutex);
+        }
+        m_condition.notify_one();
+    }
+}
+
+inline void ThreadPool::RunTask(uint32_t index, QueuedTask& entry) noexcept
+{
+    auto& task = entry.task;
+    int64_t start = 0;
+    if (entry.enqueue_time && m_metrics_enabled.load(std::memory_order_relaxed))
+        start = Now();
+
+    try
+    {
+        task();
+    } catch (const std::exception& e)
+    {
+        logger->error("Uncaught exception in thread pool task: {}", e.what());
+    } catch (...)
+    {
+        logger->error("Uncaught unknown exception in thread pool task");
+    }
+    // release the captures before the worker goes looking for more work
+    task.Reset();
+
+    if (start)
+    {
+        // only this worker writes its counters, so plain load/store pairs are enough
+        auto& counters = m_counters[index];
+        auto wait = static_cast<uint64_t>(start - entry.enqueue_time);
+        auto run = static_cast<uint64_t>(Now() - start);
+        auto relaxed = std::memory_order_relaxed;
+        counters.tasks.store(counters.tasks.load(relaxed) + 1, relaxed);
+        counters.wait_ns.store(counters.wait_ns.load(relaxed) + wait, relaxed);
+        counters.run_ns.store(counters.run_ns.load(relaxed) + run, relaxed);
+        if (wait > counters.max_wait_ns.load(relaxed))
+            counters.max_wait_ns.store(wait, relaxed);
+        if (run > counters.max_run_ns.load(relaxed))
+            counters.max_run_ns.store(run, relaxed);
+    }
+}
+
+inline void ThreadPool::WorkerLoop(uint32_t index)
+{
+    if (m_options.scheduling == SchedulingPolicy::WORK_STEALING)
+    {
+        WorkStealingLoop(index);
+        return;
+    }
+
+    for (;;)
+    {
+        QueuedTask entry;
+        {
+            std::unique_lock<std::mutex> lock(m_queue_mutex);
+            if (!WaitForWork(lock, index, [this] { return m_stop || !m_tasks.Empty(); }))
+                return;
+            if (m_stop && m_tasks.Empty())
+                return;
+            m_tasks.Pop(entry, &ThreadPool::Now);
+        }
+        RunTask(index, entry);
+    }
+}
+
+inline void ThreadPool::WorkStealingLoop(uint32_t index)
+{
+    auto& context = internal::CurrentThreadPoolWorker();
+    context.pool = this;
+    context.index = static_cast<int32_t>(index);
+
+    for (;;)
+    {
+        QueuedTask entry;
+        if (TryPopTask(index, entry))
+        {
+            RunTask(index, entry);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_queue_mutex);
+        m_sleeping.fetch_add(1);
+        bool keep = WaitForWork(lock, index, [this] { return m_stop || m_pending.load() > 0; });
+        m_sleeping.fetch_sub(1);
+        if (!keep || (m_stop && m_pending.load() == 0))
+            break;
+    }
+
+    context.pool = nullptr;
+    context.index = -1;
+}
+
+inline bool ThreadPool::TryPopShared(QueuedTask& entry)
+{
+    std::lock_guard<std::mutex> lock(m_queue_mutex);
+    if (m_tasks.Empty())
+        return false;
+    if (m_tasks.Pop(entry, &ThreadPool::Now) > TaskPriority::NORMAL)
+        m_urgent.fetch_sub(1);
+    m_injected.fetch_sub(1);
+    m_pending.fetch_sub(1);
+    return true;
+}
+
+inline bool ThreadPool::TryPopTask(uint32_t index, QueuedTask& entry)
+{
+    // 1. HIGH and CRITICAL tasks from the shared queues go first
+    if (m_urgent.load() > 0 && TryPopShared(entry))
+        return true;
+
+    // 2. LIFO from the worker's own deque, the most recently spawned task is likely cache hot
+    {
+        auto& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.Empty())
+        {
+            entry = worker.tasks.PopBack();
+            m_pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // 3. the shared queues, skip the shared mutex if they are known to be empty
+    if (m_injected.load() > 0 && TryPopShared(entry))
+        return true;
+
+    // 4. FIFO steal from the other workers, starting with the next one
+    auto count = static_cast<uint32_t>(m_workers.size());
+    for (uint32_t i = 1; i < count; ++i)
+    {
+        auto& victim = *m_workers[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.Empty())
+        {
+            entry = victim.tasks.PopFront();
+            m_pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void ThreadPool::EnableMetrics(bool enable)
+{
+    if (enable)
+        ResetMetrics();
+    m_metrics_enabled = enable;
+}
+
+inline bool ThreadPool::IsMetricsEnabled() const
+{
+    return m_metrics_enabled;
+}
+
+inline void ThreadPool::ResetMetrics()
+{
+    // counters are owned by the workers, a reset racing with a running task may keep that task
+    for (auto& counters : m_counters)
+    {
+        counters.tasks = 0;
+        counters.wait_ns = 0;
+        counters.max_wait_ns = 0;
+        counters.run_ns = 0;
+        counters.max_run_ns = 0;
+    }
+    m_queue_depth_high_water = 0;
+    m_metrics_start = Now();
+}
+
+inline ThreadPoolMetrics ThreadPool::GetMetrics() const
+{
+    auto relaxed = std::memory_order_relaxed;
+    ThreadPoolMetrics metrics;
+    auto elapsed_ns = static_cast<double>(Now() - m_metrics_start.load());
+    metrics.elapsed_s = elapsed_ns / 1e9;
+
+    double wait_ns = 0;
+    double run_ns = 0;
+    for (const auto& counters : m_counters)
+    {
+        ThreadPoolMetrics::Worker worker;
+        worker.tasks = counters.tasks.load(relaxed);
+        auto worker_wait_ns = static_cast<double>(counters.wait_ns.load(relaxed));
+        auto worker_run_ns = static_cast<double>(counters.run_ns.load(relaxed));
+        worker.max_wait_us = counters.max_wait_ns.load(relaxed) / 1e3;
+        worker.max_run_us = counters.max_run_ns.load(relaxed) / 1e3;
+        if (worker.tasks)
+        {
+            worker.avg_wait_us = worker_wait_ns / worker.tasks / 1e3;
+            worker.avg_run_us = worker_run_ns / worker.tasks / 1e3;
+        }
+        if (elapsed_ns > 0)
+        {
+            worker.busy_ratio = std::min(1.0, worker_run_ns / elapsed_ns);
+            worker.tasks_per_sec = worker.tasks / metrics.elapsed_s;
+        }
+
+        metrics.tasks += worker.tasks;
+        wait_ns += worker_wait_ns;
+        run_ns += worker_run_ns;
+        metrics.max_wait_us = std::max(metrics.max_wait_us, worker.max_wait_us);
+        metrics.max_run_us = std::max(metrics.max_run_us, worker.max_run_us);
+        metrics.workers.push_back(worker);
+    }
+    if (metrics.tasks)
+    {
+        metrics.avg_wait_us = wait_ns / metrics.tasks / 1e3;
+        metrics.avg_run_us = run_ns / metrics.tasks / 1e3;
+    }
+    if (elapsed_ns > 0)
+        metrics.tasks_per_sec = metrics.tasks / metrics.elapsed_s;
+
+    if (m_options.scheduling == SchedulingPolicy::WORK_STEALING)
+    {
+        metrics.queue_depth = m_pending.load();
+    } else
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        metrics.queue_depth = m_tasks.Size();
+    }
+    metrics.queue_depth_high_water = m_queue_depth_high_water.load();
+    return metrics;
+}
+
+inline void ThreadPool::SetMetricsLogInterval(std::chrono::milliseconds interval)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_metrics_mutex);
+        m_metrics_interval = std::chrono::milliseconds(0);
+    }
+    m_metrics_condition.notify_all();
+    if (m_metrics_thread.joinable())
+        m_metrics_thread.join();
+
+    if (interval.count() > 0)
+    {
+        m_metrics_interval = interval;
+        m_metrics_thread = std::thread([this] { MetricsLogLoop(); });
+    }
+}
+
+inline void ThreadPool::MetricsLogLoop()
+{
+    std::unique_lock<std::mutex> lock(m_metrics_mutex);
+    while (m_metrics_interval.count() > 0)
+    {
+        if (m_metrics_condition.wait_for(lock, m_metrics_interval, [this] {
+                return m_metrics_interval.count() == 0;
+            }))
+            break;
+        if (!m_metrics_enabled)
+            continue;
+
+        auto metrics = GetMetrics();
+        double busy = 0;
+        for (const auto& worker : metrics.workers)
+            busy += worker.busy_ratio;
+        if (!metrics.workers.empty())
+            busy /= metrics.workers.size();
+        logger->info(
+            "Thread pool metrics: {} tasks, {:.1f} tasks/s, wait avg {:.1f} us max {:.1f} us, "
+            "run avg {:.1f} us max {:.1f} us, queue depth {} (high water {}), busy {:.1f}%",
+            metrics.tasks, metrics.tasks_per_sec, metrics.avg_wait_us, metrics.max_wait_us,
+            metrics.avg_run_us, metrics.max_run_us, metrics.queue_depth,
+            metrics.queue_depth_high_water, busy * 100);
+    }
+}
+
 }  // namespace cppbase
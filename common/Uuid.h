@@ -39,9 +39,14 @@ class Uuid
 public:
     static uuids::uuid Generate()
     {
-        static auto engine = uuids::uuid_random_generator::engine_type{};
-        seed_rng(engine);
-        static auto generator = uuids::uuid_random_generator{engine};
+        // seeding reads the whole engine state from std::random_device, only do it once per
+        // thread
+        thread_local auto engine = [] {
+            uuids::uuid_random_generator::engine_type engine;
+            seed_rng(engine);
+            return engine;
+        }();
+        thread_local auto generator = uuids::uuid_random_generator{engine};
         return generator();
     }
 };
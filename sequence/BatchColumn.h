@@ -0,0 +1,145 @@
+/**************************************************************************
+ * @file: BatchColumn.h
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ * All rights reserved.
+ *************************************************************************/
+
+#pragma once
+
+#include <common/Variant.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cppbase { namespace sequence {
+
+/**
+ * @brief Values of one input or output of a processor for every sample of a batch, see
+ *   Processor::ExecuteBatch(). Columns handed from a processor to the linked processors are
+ *   shared, not copied, so a processor must not modify its input columns.
+ */
+class BatchColumn
+{
+public:
+    using Ptr = std::shared_ptr<BatchColumn>;
+    using ConstPtr = std::shared_ptr<const BatchColumn>;
+
+    virtual ~BatchColumn() = default;
+
+    virtual size_t GetSize() const = 0;
+
+    /**
+     * @brief Get the type of the values, Variant for a VariantColumn
+     */
+    virtual cppbase::Variant::Type GetType() const = 0;
+
+    /**
+     * @brief Get the value of a sample boxed in a Variant
+     */
+    virtual cppbase::Variant GetValue(size_t index) const = 0;
+};
+
+/**
+ * @brief Column of values of the same type stored contiguously
+ */
+template <typename T>
+class TypedColumn : public BatchColumn
+{
+public:
+    TypedColumn() = default;
+    explicit TypedColumn(size_t size) : m_values(size) {}
+    explicit TypedColumn(std::vector<T> values) : m_values(std::move(values)) {}
+
+    size_t GetSize() const override { return m_values.size(); }
+    cppbase::Variant::Type GetType() const override { return cppbase::Variant::GetType<T>(); }
+    cppbase::Variant GetValue(size_t index) const override { return m_values[index]; }
+
+    const std::vector<T>& GetValues() const { return m_values; }
+    std::vector<T>& GetValues() { return m_values; }
+
+private:
+    std::vector<T> m_values;
+};
+
+/**
+ * @brief Column of boxed values of any type, empty Variants for samples without a value
+ */
+class VariantColumn : public BatchColumn
+{
+public:
+    VariantColumn() = default;
+    explicit VariantColumn(size_t size) : m_values(size) {}
+    explicit VariantColumn(std::vector<cppbase::Variant> values) : m_values(std::move(values)) {}
+
+    size_t GetSize() const override { return m_values.size(); }
+    cppbase::Variant::Type GetType() const override
+    {
+        return cppbase::Variant::GetType<cppbase::Variant>();
+    }
+    cppbase::Variant GetValue(size_t index) const override { return m_values[index]; }
+
+    const std::vector<cppbase::Variant>& GetValues() const { return m_values; }
+    std::vector<cppbase::Variant>& GetValues() { return m_values; }
+
+private:
+    std::vector<cppbase::Variant> m_values;
+};
+
+namespace internal {
+
+template <typename T>
+BatchColumn::Ptr MakeTypedColumn(const std::vector<cppbase::Variant>& values)
+{
+    for (auto& value : values)
+    {
+        if (!value.IsType<T>())
+            return nullptr;
+    }
+    std::vector<T> typed;
+    typed.reserve(values.size());
+    for (auto& value : values)
+        typed.push_back(value.GetValue<T>());
+    return std::make_shared<TypedColumn<T>>(std::move(typed));
+}
+
+}  // namespace internal
+
+/**
+ * @brief Make a column of boxed values, a TypedColumn if they're all of the same arithmetic
+ *   type, otherwise a VariantColumn
+ */
+inline BatchColumn::Ptr MakeColumn(std::vector<cppbase::Variant> values)
+{
+    if (!values.empty())
+    {
+        BatchColumn::Ptr column;
+        if ((column = internal::MakeTypedColumn<float>(values)) ||
+            (column = internal::MakeTypedColumn<double>(values)) ||
+            (column = internal::MakeTypedColumn<int>(values)) ||
+            (column = internal::MakeTypedColumn<int64_t>(values)) ||
+            (column = internal::MakeTypedColumn<bool>(values)))
+            return column;
+    }
+    return std::make_shared<VariantColumn>(std::move(values));
+}
+
+/**
+ * @brief Get a column as a TypedColumn, converts it if it isn't one, in which case all of its
+ *   values must be of type T
+ */
+template <typename T>
+std::shared_ptr<const TypedColumn<T>> ToTypedColumn(const BatchColumn::ConstPtr& column)
+{
+    if (auto typed = std::dynamic_pointer_cast<const TypedColumn<T>>(column))
+        return typed;
+    auto typed = std::make_shared<TypedColumn<T>>(column->GetSize());
+    auto& values = typed->GetValues();
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = column->GetValue(i).template GetValue<T>();
+    return typed;
+}
+
+}}  // namespace cppbase::sequence
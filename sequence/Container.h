@@ -28,36 +28,32 @@ public:
             throw std::invalid_argument("Can't add null processor to Container");
         }
 
-        m_child_param_idx[m_params.size()] = m_processors.size() - 1;
+        m_child_param_idx[m_params.size()] = static_cast<uint32_t>(m_processors.size());
         m_params.push_back(processor->GetParam());
 
         processor->SetParent(this);
+        m_proc_index.emplace(processor->GetId(), m_processors.size());
         m_processors.push_back(std::move(processor));
     }
 
     virtual void RemoveProcessor(const uuids::uuid& proc_id)
     {
-        const auto& ret = std::find_if(m_processors.begin(), m_processors.end(),
-            [proc_id](const auto& proc) { return (proc != nullptr && proc->GetId() == proc_id); });
-        if (ret != m_processors.end())
+        auto it = m_proc_index.find(proc_id);
+        if (it != m_proc_index.end())
         {
-            (*ret)->SetParent(nullptr);
-            m_processors.erase(ret);
+            auto pos = it->second;
+            m_processors[pos]->SetParent(nullptr);
+            m_processors.erase(m_processors.begin() + pos);
+            m_proc_index.erase(it);
+            // the processors after the removed one moved down
+            RebuildProcessorIndex(pos);
         }
     }
 
     const Processor* GetProcessor(const uuids::uuid& proc_id) const
     {
-        const auto& ret = std::find_if(m_processors.begin(), m_processors.end(),
-            [proc_id](const auto& proc) { return proc && proc->GetId() == proc_id; });
-        if (ret != m_processors.end())
-        {
-            return ret->get();
-        }
-        else
-        {
-            return nullptr;
-        }
+        auto it = m_proc_index.find(proc_id);
+        return it != m_proc_index.end() ? m_processors[it->second].get() : nullptr;
     }
 
     std::vector<Processor*> GetAllProcessors() const
@@ -87,7 +83,9 @@ public:
     virtual void Clear()
     {
         m_processors.clear();
+        m_proc_index.clear();
         m_child_param_idx.clear();
+        m_params.clear();
     }
 
     void SetParam(const cppbase::Variant& val, uint32_t idx)
@@ -96,11 +94,25 @@ public:
         if (it != m_child_param_idx.end())
         {
             m_processors.at(it->second)->SetParam(val);
+            m_params[idx] = val;
         }
     }
 
 protected:
     std::vector<std::shared_ptr<Processor>> m_processors;
+    // map from a processor's id to its position in m_processors
+    std::unordered_map<uuids::uuid, size_t> m_proc_index;
+
+    void RebuildProcessorIndex(size_t first = 0)
+    {
+        if (first == 0)
+            m_proc_index.clear();
+        for (auto i = first; i < m_processors.size(); ++i)
+        {
+            if (m_processors[i])
+                m_proc_index[m_processors[i]->GetId()] = i;
+        }
+    }
 
 private:
     // Keep track of location of sub-processor parameters in a map
@@ -113,6 +125,7 @@ private:
     {
         SERIALIZE_BASE_CLASS(archive, Processor);
         archive(m_processors);
+        RebuildProcessorIndex();
     }
 
     ENABLE_TYPE_INFO(Processor)
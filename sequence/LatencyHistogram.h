@@ -0,0 +1,83 @@
+/**************************************************************************
+ * @file: LatencyHistogram.h
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ * All rights reserved.
+ *************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace cppbase { namespace sequence {
+
+/**
+ * @brief Histogram of latencies in power of two microsecond buckets, bucket i counts the
+ *   latencies in [2^(i-1), 2^i) us, bucket 0 the ones below 1 us
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr size_t BUCKET_COUNT = 40;
+
+    void Record(double latency_us)
+    {
+        latency_us = std::max(latency_us, 0.0);
+        size_t bucket = 0;
+        while (bucket < BUCKET_COUNT - 1 && latency_us >= GetBucketLimit(bucket))
+            bucket++;
+        m_buckets[bucket]++;
+        m_count++;
+        m_sum_us += latency_us;
+        m_min_us = std::min(m_min_us, latency_us);
+        m_max_us = std::max(m_max_us, latency_us);
+    }
+
+    void Clear() { *this = LatencyHistogram(); }
+
+    /**
+     * @brief Upper limit of a bucket in us
+     */
+    static double GetBucketLimit(size_t bucket)
+    {
+        return static_cast<double>(uint64_t(1) << bucket);
+    }
+
+    const std::array<uint64_t, BUCKET_COUNT>& GetBuckets() const { return m_buckets; }
+    uint64_t GetCount() const { return m_count; }
+    double GetMean() const { return m_count ? m_sum_us / static_cast<double>(m_count) : 0.0; }
+    double GetMin() const { return m_count ? m_min_us : 0.0; }
+    double GetMax() const { return m_max_us; }
+
+    /**
+     * @brief Upper limit of the bucket holding the p-th percentile, capped to the maximum
+     * @param p Percentile in [0, 1]
+     */
+    double GetPercentile(double p) const
+    {
+        if (m_count == 0)
+            return 0.0;
+        auto rank = static_cast<uint64_t>(p * static_cast<double>(m_count - 1)) + 1;
+        uint64_t count = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i)
+        {
+            count += m_buckets[i];
+            if (count >= rank)
+                return std::min(GetBucketLimit(i), m_max_us);
+        }
+        return m_max_us;
+    }
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> m_buckets{};
+    uint64_t m_count{0};
+    double m_sum_us{0};
+    double m_min_us{std::numeric_limits<double>::max()};
+    double m_max_us{0};
+};
+
+}}  // namespace cppbase::sequence
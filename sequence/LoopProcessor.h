@@ -0,0 +1,136 @@
+/**************************************************************************
+ * @file: LoopProcessor.h
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ * All rights reserved.
+ *************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+
+#include "Sequence.h"
+
+namespace cppbase { namespace sequence {
+
+/**
+ * @brief A sequence executed repeatedly, at most a bounded number of iterations. The inputs of
+ *   the loop are the inputs of the first iteration, the condition updates them after every
+ *   iteration and decides whether there is another one. The results of the loop are its inputs
+ *   after the last iteration, its execution status counts the iterations.
+ *
+ *   Nested in a sequence, the iterations are a cycle of a condition task in the subflow of the
+ *   loop's task, so the processors of every iteration are scheduled on the workers of the
+ *   executor like the ones of the parent.
+ */
+class LoopProcessor : public Sequence
+{
+public:
+    /**
+     * @brief Called after every successful iteration with the number of iterations done and the
+     *   inputs, which it may update for the next iteration, or as the results of the loop after
+     *   the last one
+     * @return false to stop the loop
+     */
+    using Condition =
+        std::function<bool(uint32_t iteration, std::vector<cppbase::Variant>& inputs)>;
+
+    LoopProcessor() = default;
+    /**
+     * @param max_iterations Maximum number of iterations, at least one
+     * @param condition Without a condition the loop always executes max_iterations iterations
+     */
+    LoopProcessor(uint32_t max_iterations, Condition condition)
+      : m_max_iterations(std::max<uint32_t>(max_iterations, 1)), m_condition(std::move(condition))
+    {}
+    ~LoopProcessor() override = default;
+
+    void SetMaxIterations(uint32_t max_iterations)
+    {
+        m_max_iterations = std::max<uint32_t>(max_iterations, 1);
+    }
+
+    uint32_t GetMaxIterations() const { return m_max_iterations; }
+
+    void SetCondition(Condition condition) { m_condition = std::move(condition); }
+
+    /**
+     * @brief Get the number of iterations of the last execution
+     */
+    uint32_t GetIterations() const { return m_iterations; }
+
+    ExecutionStatus Execute(const std::vector<cppbase::Variant>& inputs) override
+    {
+        std::vector<cppbase::Variant> state = inputs;
+        uint32_t iteration = 0;
+        ExecutionStatus status;
+        do
+        {
+            status = Sequence::Execute(state);
+        } while (Continue(status, ++iteration, state));
+        return FinishLoop(status, iteration, std::move(state));
+    }
+
+    ExecutionStatus ExecuteNested(tf::Subflow& subflow, const std::vector<cppbase::Variant>& inputs,
+                                  std::vector<cppbase::Variant>& results) override
+    {
+        // the tasks of the iterations may run on any worker, so unlike a sequence the loop
+        // doesn't hold its execution mutex across them
+        std::vector<cppbase::Variant> state = inputs;
+        std::vector<cppbase::Variant> iteration_results;
+        uint32_t iteration = 0;
+        ExecutionStatus status;
+        auto body = subflow.emplace([this, &state, &iteration_results, &status](tf::Subflow& sf) {
+            status = Sequence::ExecuteNested(sf, state, iteration_results);
+        });
+        auto next = subflow.emplace([this, &state, &iteration, &status]() {
+            return Continue(status, ++iteration, state) ? 0 : 1;
+        });
+        // the body's only other dependency is the weak one of the condition task, so the loop
+        // needs an initial task to start it
+        auto init = subflow.placeholder();
+        auto done = subflow.placeholder();
+        init.precede(body);
+        body.precede(next);
+        next.precede(body, done);
+        subflow.join();
+
+        status = FinishLoop(status, iteration, std::move(state));
+        results = GetResults();
+        return status;
+    }
+
+    // the iterations depend on each sample, so the samples are executed one at a time
+    ExecutionStatus ExecuteBatch(size_t batch_size,
+                                 const std::vector<BatchColumn::ConstPtr>& inputs,
+                                 std::vector<BatchColumn::Ptr>& outputs) override
+    {
+        return Processor::ExecuteBatch(batch_size, inputs, outputs);
+    }
+
+protected:
+    bool Continue(const ExecutionStatus& status, uint32_t iteration,
+                  std::vector<cppbase::Variant>& state)
+    {
+        return status.exec_status == ExecStatus::PASS &&
+               (!m_condition || m_condition(iteration, state)) && iteration < m_max_iterations;
+    }
+
+    ExecutionStatus FinishLoop(const ExecutionStatus& status, uint32_t iteration,
+                               std::vector<cppbase::Variant> state)
+    {
+        m_iterations = iteration;
+        std::lock_guard<std::mutex> lock(m_results_mutex);
+        m_results = std::move(state);
+        return status;
+    }
+
+private:
+    uint32_t m_max_iterations{1};
+    Condition m_condition;
+    std::atomic<uint32_t> m_iterations{0};
+};
+
+}}  // namespace cppbase::sequence
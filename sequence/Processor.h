@@ -18,6 +18,8 @@
 #include <future>
 #include <memory>
 
+#include "BatchColumn.h"
+
 namespace cppbase { namespace sequence {
 
 /**
@@ -132,6 +134,11 @@ public:
         return types;
     }
 
+    /**
+     * @brief Get the number of the processor's inputs
+     */
+    size_t GetInputCount() const { return m_inputs.size(); }
+
     /**
      * @brief Get the processor's output types
      *
@@ -157,7 +164,7 @@ public:
         if (inputs.size() > m_inputs.size())
             return false;
 
-        for (auto input : inputs)
+        for (const auto& input : inputs)
         {
             std::vector<std::pair<std::string, cppbase::PropertyPath>>::iterator it = std::find_if(
                 m_inputs.begin(), m_inputs.end(),
@@ -290,7 +297,11 @@ public:
      * @brief: Set parameter of the processor
      * @param param: value of the parameter
      */
-    virtual void SetParam(const cppbase::Variant& param) { m_param = param; }
+    virtual void SetParam(const cppbase::Variant& param)
+    {
+        m_param = param;
+        MarkDirty();
+    }
 
     /**
      * @brief: Get parameter of the processor
@@ -298,6 +309,26 @@ public:
      */
     virtual const cppbase::Variant& GetParam() const { return m_param; }
 
+    /**
+     * @brief: Mark the parameters of the processor as changed, so that a caching sequence
+     *   executes it again. Called by SetParam() and Initialize(), processors changing their
+     *   parameters in other ways call it themselves.
+     */
+    void MarkDirty() { m_param_version.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief: Get the version of the parameters, which MarkDirty() increments
+     */
+    uint64_t GetParamVersion() const { return m_param_version.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief: Set if the results of the processor only depend on its inputs and parameters, so
+     *   that a caching sequence may reuse them. True by default, processors reading devices or
+     *   keeping state between executions aren't cacheable.
+     */
+    void SetCacheable(bool cacheable) { m_cacheable = cacheable; }
+    bool IsCacheable() const { return m_cacheable; }
+
     /**
      * @brief: Get the current mode of the processor
      * @return: Mode
@@ -344,6 +375,7 @@ public:
     virtual bool Initialize(const cppbase::Variant& param = {})
     {
         m_param = param;
+        MarkDirty();
 
         m_inputs.clear();
         m_outputs.clear();
@@ -361,6 +393,72 @@ public:
      */
     virtual ExecutionStatus Execute(const std::vector<cppbase::Variant>& inputs) = 0;
 
+    /**
+     * @brief: Execute the processor and get the results of this execution
+     * @param inputs: inputs
+     * @param results: results of the execution
+     * @return: ExecutionStatus
+     * @note: Called by a pipelined sequence, which can execute a parallel stage for several
+     *   triggers at the same time. The default serializes the executions. Processors that
+     *   can be executed concurrently override it without using members shared between calls.
+     */
+    virtual ExecutionStatus ExecuteReentrant(const std::vector<cppbase::Variant>& inputs,
+                                             std::vector<cppbase::Variant>& results)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_exec_mutex);
+        auto status = Execute(inputs);
+        results = GetResults();
+        return status;
+    }
+
+    /**
+     * @brief: Execute the processor for a batch of samples at once
+     * @param batch_size: number of samples
+     * @param inputs: per input, a column with the input of every sample
+     * @param outputs: per output, a column with the result of every sample
+     * @return: ExecutionStatus of the batch, FAIL if any sample failed
+     * @note: Processors override it to process the samples as contiguous typed columns, see
+     *   ToTypedColumn(), and without the per sample overhead of Execute(). The default executes
+     *   the samples one at a time with ExecuteReentrant().
+     */
+    virtual ExecutionStatus ExecuteBatch(size_t batch_size,
+                                         const std::vector<BatchColumn::ConstPtr>& inputs,
+                                         std::vector<BatchColumn::Ptr>& outputs)
+    {
+        cppbase::TimerUs timer;
+        timer.Start();
+        ExecutionStatus batch_status;
+        batch_status.id = m_id;
+        std::vector<cppbase::Variant> sample_inputs(inputs.size());
+        std::vector<cppbase::Variant> sample_results;
+        std::vector<std::vector<cppbase::Variant>> columns;
+        for (size_t i = 0; i < batch_size; ++i)
+        {
+            for (size_t j = 0; j < inputs.size(); ++j)
+                sample_inputs[j] = inputs[j]->GetValue(i);
+            auto status = ExecuteReentrant(sample_inputs, sample_results);
+            if (status.exec_status == ExecStatus::FAIL)
+            {
+                batch_status.exec_status = ExecStatus::FAIL;
+                batch_status.err_msg = status.err_msg;
+                continue;
+            }
+            if (status.exec_status != ExecStatus::PASS)
+                continue;
+            if (batch_status.exec_status == ExecStatus::SKIPPED)
+                batch_status.exec_status = ExecStatus::PASS;
+            if (columns.size() < sample_results.size())
+                columns.resize(sample_results.size(), std::vector<cppbase::Variant>(batch_size));
+            for (size_t j = 0; j < sample_results.size(); ++j)
+                columns[j][i] = std::move(sample_results[j]);
+        }
+        outputs.clear();
+        for (auto& column : columns)
+            outputs.push_back(MakeColumn(std::move(column)));
+        batch_status.exec_time_us = static_cast<double>(timer.Elapsed());
+        return batch_status;
+    }
+
 protected:
     /**
      * @brief Check input type and set the input type of the algorithm
@@ -416,6 +514,8 @@ protected:
     std::vector<std::pair<std::string, cppbase::PropertyPath>> m_inputs;
     std::vector<std::pair<std::string, cppbase::PropertyPath>> m_outputs;
     cppbase::Variant m_param;
+    std::atomic<uint64_t> m_param_version{0};
+    bool m_cacheable{true};
     std::vector<cppbase::Variant> m_results;
     mutable std::mutex m_results_mutex;
     mutable std::recursive_mutex m_exec_mutex;
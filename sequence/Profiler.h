@@ -0,0 +1,246 @@
+/**************************************************************************
+ * @file: Profiler.h
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ * All rights reserved.
+ *************************************************************************/
+
+#pragma once
+
+#include <common/Uuid.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cppbase { namespace sequence {
+
+/**
+ * @brief Records the executions of the processors of a sequence: per trigger, the start and end
+ *   of every processor, the worker it ran on, how long it waited for a worker once its inputs
+ *   were ready and how long copying its inputs took. Keeps rolling percentiles of the execution
+ *   times per processor and exports the recorded triggers as Chrome trace events, which can be
+ *   opened in about://tracing or Perfetto.
+ */
+class Profiler
+{
+public:
+    /**
+     * @brief Execution of a processor for a trigger, times in ns since the profiler was created
+     */
+    struct ProcessorEvent
+    {
+        uuids::uuid id;
+        std::string name;
+        int64_t ready_ns{0};
+        int64_t start_ns{0};
+        int64_t end_ns{0};
+        int64_t input_copy_ns{0};
+        // worker of the executor, -1 for a thread outside of the executor
+        int worker{-1};
+        bool cached{false};
+    };
+
+    struct TriggerRecord
+    {
+        uint64_t trigger{0};
+        int64_t start_ns{0};
+        int64_t end_ns{0};
+        std::vector<ProcessorEvent> events;
+    };
+
+    /**
+     * @brief Execution time percentiles of a processor over the rolling window
+     */
+    struct Statistics
+    {
+        uint64_t count{0};
+        double p50_us{0};
+        double p95_us{0};
+        double p99_us{0};
+        double max_us{0};
+    };
+
+    /**
+     * @param max_triggers Number of the latest triggers kept for the trace
+     * @param window Number of the latest executions of a processor the percentiles are over
+     */
+    explicit Profiler(size_t max_triggers = 1000, size_t window = 1024)
+      : m_max_triggers(std::max<size_t>(max_triggers, 1)), m_window(std::max<size_t>(window, 1))
+    {}
+
+    int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - m_epoch)
+            .count();
+    }
+
+    void AddTrigger(TriggerRecord record)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& event : record.events)
+        {
+            // cached processors weren't executed, they would only bring the percentiles down
+            if (event.cached || event.end_ns == 0)
+                continue;
+            auto& window = m_windows[event.id];
+            auto duration_us = static_cast<double>(event.end_ns - event.start_ns) / 1000.0;
+            if (window.durations.size() < m_window)
+                window.durations.push_back(duration_us);
+            else
+                window.durations[window.count % m_window] = duration_us;
+            window.count++;
+        }
+        m_triggers.push_back(std::move(record));
+        if (m_triggers.size() > m_max_triggers)
+            m_triggers.pop_front();
+    }
+
+    Statistics GetStatistics(const uuids::uuid& proc_id) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Statistics stats;
+        auto it = m_windows.find(proc_id);
+        if (it == m_windows.end() || it->second.durations.empty())
+            return stats;
+
+        auto durations = it->second.durations;
+        std::sort(durations.begin(), durations.end());
+        auto percentile = [&durations](double p) {
+            auto rank = static_cast<size_t>(p * static_cast<double>(durations.size() - 1) + 0.5);
+            return durations[rank];
+        };
+        stats.count = it->second.count;
+        stats.p50_us = percentile(0.50);
+        stats.p95_us = percentile(0.95);
+        stats.p99_us = percentile(0.99);
+        stats.max_us = durations.back();
+        return stats;
+    }
+
+    std::vector<TriggerRecord> GetTriggers() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return {m_triggers.begin(), m_triggers.end()};
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_triggers.clear();
+        m_windows.clear();
+    }
+
+    /**
+     * @brief Write the recorded triggers in the Chrome trace event format, one row per worker
+     * @param name Name of the trigger events, the sequence's name
+     */
+    void WriteChromeTrace(std::ostream& os, const std::string& name = "Sequence") const
+    {
+        auto triggers = GetTriggers();
+        std::vector<int> workers;
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        auto begin_event = [&os, &first]() {
+            os << (first ? "\n" : ",\n");
+            first = false;
+        };
+        for (auto& trigger : triggers)
+        {
+            begin_event();
+            os << "{\"name\":\"" << Escape(name) << " #" << trigger.trigger
+               << "\",\"cat\":\"trigger\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":"
+               << ToUs(trigger.start_ns) << ",\"dur\":" << ToUs(trigger.end_ns - trigger.start_ns)
+               << "}";
+            for (auto& event : trigger.events)
+            {
+                if (event.end_ns == 0)
+                    continue;
+                if (std::find(workers.begin(), workers.end(), event.worker) == workers.end())
+                    workers.push_back(event.worker);
+                begin_event();
+                os << "{\"name\":\"" << Escape(event.name)
+                   << "\",\"cat\":\"processor\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.worker + 2
+                   << ",\"ts\":" << ToUs(event.start_ns)
+                   << ",\"dur\":" << ToUs(event.end_ns - event.start_ns)
+                   << ",\"args\":{\"id\":\"" << uuids::to_string(event.id)
+                   << "\",\"trigger\":" << trigger.trigger
+                   << ",\"queue_wait_us\":" << ToUs(event.start_ns - event.ready_ns)
+                   << ",\"input_copy_us\":" << ToUs(event.input_copy_ns)
+                   << ",\"cached\":" << (event.cached ? "true" : "false") << "}}";
+            }
+        }
+        begin_event();
+        os << R"({"name":"thread_name","ph":"M","pid":1,"tid":0,"args":{"name":"triggers"}})";
+        for (auto worker : workers)
+        {
+            begin_event();
+            os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << worker + 2
+               << ",\"args\":{\"name\":\""
+               << (worker < 0 ? std::string("caller") : "worker " + std::to_string(worker))
+               << "\"}}";
+        }
+        os << "\n]}\n";
+    }
+
+    /**
+     * @brief Write the recorded triggers to a Chrome trace event file
+     * @return false if the file couldn't be written
+     */
+    bool ExportChromeTrace(const std::string& path, const std::string& name = "Sequence") const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        WriteChromeTrace(file, name);
+        return static_cast<bool>(file);
+    }
+
+private:
+    static double ToUs(int64_t ns) { return static_cast<double>(ns) / 1000.0; }
+
+    static std::string Escape(const std::string& str)
+    {
+        std::string escaped;
+        escaped.reserve(str.size());
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                escaped += ' ';
+            } else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    struct Window
+    {
+        std::vector<double> durations;
+        uint64_t count{0};
+    };
+
+    const std::chrono::steady_clock::time_point m_epoch{std::chrono::steady_clock::now()};
+    const size_t m_max_triggers;
+    const size_t m_window;
+    mutable std::mutex m_mutex;
+    std::deque<TriggerRecord> m_triggers;
+    std::unordered_map<uuids::uuid, Window> m_windows;
+};
+
+}}  // namespace cppbase::sequence
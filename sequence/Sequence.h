@@ -11,14 +11,55 @@
 #include <common/Timer.h>
 
 #include <taskflow/taskflow.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "Container.h"
+#include "LatencyHistogram.h"
 #include "Link.h"
+#include "Profiler.h"
+#include "SwitchProcessor.h"
 
 namespace cppbase { namespace sequence {
 
+/**
+ * @brief Thrown by Sequence::Compile() if the processors and links of a sequence can't be
+ *   executed, carries the names of the processors at fault
+ */
+class CompileError : public std::logic_error
+{
+public:
+    CompileError(const std::string& message, std::vector<std::string> processors)
+      : std::logic_error(FormatMessage(message, processors)), m_processors(std::move(processors))
+    {}
+
+    const std::vector<std::string>& GetProcessors() const { return m_processors; }
+
+private:
+    static std::string FormatMessage(const std::string& message,
+                                     const std::vector<std::string>& processors)
+    {
+        std::string formatted = message;
+        for (size_t i = 0; i < processors.size(); ++i)
+            formatted += (i == 0 ? ": " : ", ") + processors[i];
+        return formatted;
+    }
+
+    std::vector<std::string> m_processors;
+};
+
 class Sequence : public Container
 {
 public:
@@ -28,6 +69,10 @@ public:
         uint64_t exec_count{0};
         uint64_t ok_count{0};
         uint64_t ng_count{0};
+        // processors whose cached results were reused by the last execution
+        std::vector<uuids::uuid> cached_processors;
+        // processors pruned by the last execution since they're on untaken branches
+        std::vector<uuids::uuid> pruned_processors;
 
         SequenceExecutionStatus& operator=(const Processor::ExecutionStatus& status)
         {
@@ -39,24 +84,315 @@ public:
         }
     };
 
+    /**
+     * @brief: Stage type of a processor in a pipelined sequence
+     *   SERIAL   - the processor executes one trigger at a time, in the order of the triggers
+     *   PARALLEL - the processor may execute several triggers at the same time in any order,
+     *              see Processor::ExecuteReentrant()
+     */
+    enum class StageType : int
+    {
+        SERIAL = 0,
+        PARALLEL = 1
+    };
+
+    /**
+     * @brief: What Trigger() does when the trigger queue is full
+     *   DROP_OLDEST - the oldest pending trigger is dropped
+     *   COALESCE    - the newest pending trigger takes the new inputs and keeps its trigger time
+     */
+    enum class TriggerPolicy : int
+    {
+        DROP_OLDEST = 0,
+        COALESCE = 1
+    };
+
 public:
     Sequence() = default;
     virtual ~Sequence()
     {
-        if (m_exec_thread.joinable())
+        m_mode = Mode::PROGRAM;
+        StopRunThread();
+        WaitForPipeline();
+    }
+
+    /**
+     * @brief Get the executor that runs the processors of all sequences
+     * @note  It has at least 4 workers, since processors often wait for devices or I/O.
+     */
+    static tf::Executor& GetExecutor()
+    {
+        static tf::Executor executor{std::max(4u, std::thread::hardware_concurrency())};
+        return executor;
+    }
+
+    /**
+     * @brief Limit the number of the sequence's processors that execute at the same time
+     * @param concurrency 0 for no limit other than the executor's workers. The default is 1,
+     *   since processors of a sequence that run concurrently must not share state other than
+     *   through links.
+     */
+    void SetConcurrency(uint32_t concurrency)
+    {
+        m_concurrency = concurrency;
+        InvalidateGraph();
+    }
+
+    uint32_t GetConcurrency() const { return m_concurrency; }
+
+    /**
+     * @brief Record the executions of the processors for every trigger, see Profiler
+     */
+    void SetProfiling(bool profiling) { m_profiling = profiling; }
+    bool GetProfiling() const { return m_profiling; }
+    Profiler& GetProfiler() { return m_profiler; }
+    const Profiler& GetProfiler() const { return m_profiler; }
+
+    /**
+     * @brief Cache the results of the processors, so that executing the sequence again only
+     *   executes the processors whose parameters or inputs changed, and reuses the cached
+     *   results of the others. A processor's inputs changed if a sequence input mapped to it
+     *   isn't equal to the last one, or if a processor linked into it was executed again.
+     * @note  Only applies to Execute(), not to pipelined executions. Changing the links or the
+     *   processors of the sequence clears the cache.
+     */
+    void SetCaching(bool caching)
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        m_caching = caching;
+        // an execution in a subflow may still use the cache, the next one compiles a new graph
+        if (m_subflows > 0)
+            m_graph_valid.store(false, std::memory_order_release);
+        else if (m_graph)
+            ClearCache(*m_graph);
+    }
+
+    bool GetCaching() const { return m_caching; }
+
+    /**
+     * @brief Pipeline the executions of the sequence. The processors become stages and a
+     *   trigger enters a stage as soon as the stage's predecessors are done with it, while the
+     *   later stages still work on earlier triggers. The throughput then approaches the one of
+     *   the slowest stage instead of the one of the whole sequence.
+     * @param max_tokens Number of triggers in flight at a time, 0 disables pipelining
+     * @note  The concurrency limit doesn't apply to pipelined executions.
+     */
+    void SetPipelined(uint32_t max_tokens)
+    {
+        std::lock_guard<std::mutex> execute_lock(m_execute_mutex);
+        WaitForPipeline();
+        std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+        m_max_tokens = max_tokens;
+        m_tokens.clear();
+    }
+
+    uint32_t GetMaxTokens() const { return m_max_tokens; }
+
+    /**
+     * @brief Set the stage type of a processor in a pipelined sequence, SERIAL by default
+     */
+    void SetStageType(const uuids::uuid& proc_id, StageType type)
+    {
+        m_stage_types[proc_id] = type;
+        InvalidateGraph();
+    }
+
+    /**
+     * @brief Submit a trigger to the pipeline, waits while the maximum number of triggers are
+     *   in flight. Executes the sequence right away if it isn't pipelined.
+     */
+    void Submit(const std::vector<cppbase::Variant>& inputs)
+    {
+        SubmitTrigger(inputs, std::nullopt);
+    }
+
+    /**
+     * @brief Queue a trigger, the run thread executes the sequence with the inputs in RUN and
+     *   TEST mode and sleeps while no trigger is pending. Triggers still pending when the
+     *   sequence leaves RUN and TEST mode are discarded.
+     * @return false if the queue was full and a pending trigger was dropped or coalesced
+     */
+    bool Trigger(std::vector<cppbase::Variant> inputs)
+    {
+        bool queued;
         {
-            m_mode = Mode::PROGRAM;
-            m_exec_thread.join();
+            std::lock_guard<std::mutex> lock(m_trigger_mutex);
+            queued = EnqueueTrigger(std::move(inputs), std::chrono::steady_clock::now());
+        }
+        m_trigger_condition.notify_one();
+        return queued;
+    }
+
+    /**
+     * @brief Set the size of the trigger queue and what happens to triggers when it's full
+     */
+    void SetTriggerQueue(size_t capacity, TriggerPolicy policy = TriggerPolicy::DROP_OLDEST)
+    {
+        std::lock_guard<std::mutex> lock(m_trigger_mutex);
+        m_trigger_capacity = std::max<size_t>(capacity, 1);
+        m_trigger_policy = policy;
+        while (m_trigger_queue.size() > m_trigger_capacity)
+        {
+            m_trigger_queue.pop_front();
+            m_dropped_triggers++;
+        }
+    }
+
+    size_t GetTriggerQueueCapacity() const { return m_trigger_capacity; }
+    TriggerPolicy GetTriggerPolicy() const { return m_trigger_policy; }
+
+    /**
+     * @brief Trigger the sequence without inputs at a fixed rate in RUN and TEST mode. Ticks
+     *   missed while the sequence was busy are skipped.
+     * @param interval Time between triggers, 0 disables the timer
+     */
+    void SetTriggerInterval(std::chrono::microseconds interval)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_trigger_mutex);
+            m_trigger_interval = interval;
+            m_next_tick = std::chrono::steady_clock::now() + interval;
         }
+        m_trigger_condition.notify_one();
+    }
+
+    std::chrono::microseconds GetTriggerInterval() const { return m_trigger_interval; }
+
+    /**
+     * @brief Let the run thread execute the pending triggers in batches of up to batch_size with
+     *   ExecuteBatch(), a single pending trigger is executed on its own
+     * @param batch_size 1 executes every trigger on its own
+     * @note  Pipelined sequences execute every trigger on its own.
+     */
+    void SetBatchSize(size_t batch_size)
+    {
+        std::lock_guard<std::mutex> lock(m_trigger_mutex);
+        m_batch_size = std::max<size_t>(batch_size, 1);
+    }
+
+    size_t GetBatchSize() const { return m_batch_size; }
+
+    /**
+     * @brief Get the number of triggers dropped or coalesced because the queue was full
+     */
+    uint64_t GetDroppedTriggers() const { return m_dropped_triggers.load(); }
+
+    /**
+     * @brief Get the histogram of the times from the triggers to the completion of their
+     *   executions
+     */
+    LatencyHistogram GetTriggerLatency() const
+    {
+        std::lock_guard<std::mutex> lock(m_latency_mutex);
+        return m_trigger_latency;
+    }
+
+    void ResetTriggerLatency()
+    {
+        std::lock_guard<std::mutex> lock(m_latency_mutex);
+        m_trigger_latency.Clear();
+    }
+
+    /**
+     * @brief Wait until all submitted triggers have completed
+     */
+    void WaitForPipeline()
+    {
+        std::unique_lock<std::mutex> lock(m_pipeline_mutex);
+        m_pipeline_condition.wait(lock, [this] { return m_in_flight == 0; });
     }
 
     template <typename T>
     Processor* CreateProcessor()
     {
-        m_processors.push_back(std::make_shared<T>());
+        AddProcessor(std::make_shared<T>());
         return m_processors.back().get();
     }
 
+    void AddProcessor(std::shared_ptr<Processor> processor) override
+    {
+        Container::AddProcessor(std::move(processor));
+        InvalidateGraph();
+    }
+
+    /**
+     * @brief Remove a processor together with its links, input map and stage type
+     */
+    void RemoveProcessor(const uuids::uuid& proc_id) override
+    {
+        Container::RemoveProcessor(proc_id);
+        m_proc_links.erase(proc_id);
+        for (auto& element : m_proc_links)
+        {
+            auto& links = element.second;
+            auto linked = [&proc_id](const Link& link) { return link.m_dst == proc_id; };
+            links.erase(std::remove_if(links.begin(), links.end(), linked), links.end());
+        }
+        m_proc_inputs.erase(proc_id);
+        m_stage_types.erase(proc_id);
+        InvalidateGraph();
+    }
+
+    void Clear() override
+    {
+        Container::Clear();
+        m_proc_links.clear();
+        m_proc_inputs.clear();
+        m_stage_types.clear();
+        InvalidateGraph();
+    }
+
+    /**
+     * @brief Validate the processors, links and input map and compile them into the execution
+     *   graph: the types of the linked outputs and inputs must match, the links and the input
+     *   map must refer to existing processors, inputs and outputs, and the links must not form
+     *   a cycle. Execute() compiles the sequence if it changed since it was last compiled, the
+     *   executions themselves don't check the topology again.
+     * @throw CompileError naming the processors at fault
+     */
+    void Compile()
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        WaitForPipeline();
+        GetGraph();
+    }
+
+    /**
+     * @brief Get the processors in the topological order they're executed in, compiles the
+     *   sequence if needed
+     */
+    std::vector<const Processor*> GetExecutionOrder()
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        WaitForPipeline();
+        const auto& graph = GetGraph();
+        std::vector<const Processor*> order;
+        order.reserve(graph.order.size());
+        for (auto index : graph.order)
+            order.push_back(graph.processors[index]);
+        return order;
+    }
+
+    /**
+     * @brief Get the level sets of the processors, compiles the sequence if needed. Level 0
+     *   holds the processors without links into them, level n the processors whose longest
+     *   path from level 0 has n links. Processors of the same level don't depend on each other.
+     */
+    std::vector<std::vector<const Processor*>> GetLevels()
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        WaitForPipeline();
+        const auto& graph = GetGraph();
+        std::vector<std::vector<const Processor*>> levels;
+        for (uint32_t i = 0; i < graph.processors.size(); ++i)
+        {
+            if (graph.levels[i] >= levels.size())
+                levels.resize(graph.levels[i] + 1);
+            levels[graph.levels[i]].push_back(graph.processors[i]);
+        }
+        return levels;
+    }
+
     const SequenceExecutionStatus& GetExecutionStatus() const { return m_exec_status; }
 
     /**
@@ -101,6 +437,7 @@ public:
             if (!exists)
                 links.push_back(new_link);
         }
+        InvalidateGraph();
     }
 
     void RemoveLink(uuids::uuid src, uuids::uuid dst = uuids::uuid(), uint32_t out_id = 0,
@@ -116,128 +453,100 @@ public:
         }
         auto& links = m_proc_links[src];
         Link new_link{src, dst, out_id, in_id};
-        links.erase(std::remove_if(links.begin(), links.end(), [&new_link](auto& link) {
+        auto matches = [&new_link](auto& link) {
             if (new_link.m_src == link.m_src)
             {
                 if (new_link.m_dst.is_nil())  // if m_dst is nullptr, remove all links with same m_src
                     return true;
                 return new_link == link;
             }
-        }));
+            return false;
+        };
+        links.erase(std::remove_if(links.begin(), links.end(), matches), links.end());
+        InvalidateGraph();
     }
 
     ExecutionStatus Execute(const std::vector<cppbase::Variant>& inputs) override
     {
-        std::vector<cppbase::Variant> seq_results;
-        std::unordered_map<uuids::uuid, std::vector<cppbase::Variant>> proc_inputs_map;
-        std::unordered_map<uuids::uuid, tf::Task> proc_task_map;
-        tf::Executor executor{1};
-        tf::Taskflow taskflow{uuids::to_string(m_id)};
+        return ExecuteGraph(inputs);
+    }
+
+    /**
+     * @brief Execute the sequence nested in a parent sequence. Its processors are emplaced into
+     *   the subflow of the parent's task, so that the executor schedules them on the same
+     *   workers and interleaves them with the parent's processors at every level of nesting.
+     *   With a concurrency of 1 the parent's task executes them one after the other instead.
+     */
+    virtual ExecutionStatus ExecuteNested(tf::Subflow& subflow,
+                                          const std::vector<cppbase::Variant>& inputs,
+                                          std::vector<cppbase::Variant>& results)
+    {
+        if (m_concurrency != 1)
+            return ExecuteSubflow(subflow, inputs, results);
+        std::lock_guard<std::recursive_mutex> lock(m_exec_mutex);
+        auto status = ExecuteGraph(inputs);
+        results = GetResults();
+        return status;
+    }
+
+    /**
+     * @brief Execute the sequence for a batch of samples, every processor is executed once for
+     *   all of them with Processor::ExecuteBatch()
+     * @param inputs Per sequence input, a column with the input of every sample
+     * @param outputs Per result of Execute(), a column with it for every sample, that is per
+     *   processor a column with the status of its batch execution
+     * @note  The processors are executed one after the other in topological order, without
+     *   caching, profiling and pruning of untaken branches. Their results are available from
+     *   GetBatchResults().
+     */
+    ExecutionStatus ExecuteBatch(size_t batch_size,
+                                 const std::vector<BatchColumn::ConstPtr>& inputs,
+                                 std::vector<BatchColumn::Ptr>& outputs) override
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        WaitForPipeline();
         std::vector<std::future<void>> futures;
-        ExecStatus exec_status{ExecStatus::PASS};
 
         m_exec_status.trigger_count++;
 
-        if (!PreExecute(inputs))
+        if (!PreExecute({}))
         {
             return m_exec_status;
         }
 
-        for (auto& proc : m_processors)
-        {
-            auto proc_id = proc->GetId();
-            // Initialize processor's inputs with sequence's inputs at the beginning, based on
-            // the processor input map in the sequence. The inputs may be overwriten during the
-            // execution if there are links linked into the processor.
-            proc_inputs_map.emplace(proc_id, std::vector<cppbase::Variant>(proc->GetInputTypes().size()));
-            if (m_proc_inputs.find(proc_id) != m_proc_inputs.end())
-            {
-                auto& proc_inputs = m_proc_inputs[proc_id];
-                for (auto& input : proc_inputs)
-                {
-                    proc_inputs_map[proc_id][input.second] = inputs[input.first];
-                }
-            }
-
-            // Add a task for each processor to the task map
-            proc_task_map.emplace(proc_id, taskflow.emplace([this, proc_id, &proc_inputs_map,
-                                                             &exec_status, &seq_results]() {
-
-                auto* proc = const_cast<Processor*>(GetProcessor(proc_id));
-                try
-                {
-                    // Get the inputs for the processor and execute
-                    auto& proc_inputs = proc_inputs_map[proc_id];
-                    auto status = proc->Execute(proc_inputs);
-                    if (status.exec_status == ExecStatus::PASS)
-                    {
-                        const auto& results = proc->GetResults();
-
-                        // Update the successor's inputs if there're links between the current processor
-                        // and its successor.
-                        auto it = m_proc_links.find(proc_id);
-                        if (it != m_proc_links.end())
-                        {
-                            for (auto& link : it->second)
-                            {
-                                if (!link.m_dst.is_nil())
-                                {
-                                    if (link.m_src_id >= results.size())
-                                    {
-                                        std::cerr
-                                            << "Link source id is out of results range, source_id = "
-                                            << link.m_src_id << " results.size() = " << results.size()
-                                            << std::endl;
-                                        throw std::out_of_range(
-                                            "Link source id is out of results range");
-                                    }
-                                    auto& dst_inputs = proc_inputs_map[link.m_dst];
-                                    if (dst_inputs.size() == link.m_src_id)
-                                    {
-                                        proc_inputs_map[link.m_dst].push_back(results[link.m_src_id]);
-                                    } else if (dst_inputs.size() > link.m_src_id)
-                                    {
-                                        proc_inputs_map[link.m_dst][link.m_dst_id] =
-                                            results[link.m_src_id];
-                                    }
-                                }
-                            }
-                        }
-                    }
-                } catch (...)
-                {
-                    exec_status = ExecStatus::FAIL;
-                }
-                seq_results.emplace_back(proc->GetExecutionStatus());
-            }));
-        }
-
-        // Sort the processors according to the links
-        for (auto element : m_proc_links)
-        {
-            auto& task = proc_task_map[element.first];
-            for (auto& link : m_proc_links[element.first])
-            {
-                if (!link.m_dst.is_nil())
-                {
-                    task.precede(proc_task_map[link.m_dst]);
-                }
-            }
-        }
-
-        // Now run the taskflow which will run each added task
-        auto future = executor.run(taskflow);
-        future.wait();
+        const auto& graph = GetGraph();
+        auto proc_count = graph.processors.size();
+        auto& frame = m_batch_frame;
+        frame.inputs = &inputs;
+        frame.batch_size = batch_size;
+        frame.failed = false;
+        frame.slots.assign(graph.edges.size(), nullptr);
+        frame.proc_inputs.resize(proc_count);
+        frame.proc_results.resize(proc_count);
+        frame.statuses.resize(proc_count);
+        frame.ids.resize(proc_count);
+        for (auto index : graph.order)
+            ExecuteBatchProcessor(frame, index);
 
+        std::vector<cppbase::Variant> seq_results;
+        seq_results.reserve(proc_count);
+        for (auto& status : frame.statuses)
+            seq_results.emplace_back(status);
         PostExecute(seq_results);
         {
             std::lock_guard<std::mutex> lock(m_results_mutex);
             m_results = seq_results;
         }
+        outputs.clear();
+        for (auto& result : seq_results)
+            outputs.push_back(
+                std::make_shared<VariantColumn>(std::vector<cppbase::Variant>(batch_size, result)));
 
         m_exec_status = Processor::GetExecutionStatus();
+        m_exec_status.cached_processors.clear();
+        m_exec_status.pruned_processors.clear();
         m_exec_status.exec_count++;
-        m_exec_status.exec_status = exec_status;
+        m_exec_status.exec_status = frame.failed ? ExecStatus::FAIL : ExecStatus::PASS;
         if (m_exec_status.exec_status == ExecStatus::PASS)
         {
             m_exec_status.ok_count++;
@@ -254,6 +563,20 @@ public:
         return m_exec_status;
     }
 
+    /**
+     * @brief Get the result columns of a processor from the last ExecuteBatch()
+     */
+    std::vector<BatchColumn::ConstPtr> GetBatchResults(const uuids::uuid& proc_id)
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        const auto& frame = m_batch_frame;
+        auto it = std::find(frame.ids.begin(), frame.ids.end(), proc_id);
+        if (it == frame.ids.end())
+            return {};
+        const auto& results = frame.proc_results[it - frame.ids.begin()];
+        return {results.begin(), results.end()};
+    }
+
     void SetMode(Mode mode) override
     {
         if (m_mode == mode)
@@ -268,15 +591,19 @@ public:
         }
         if (m_mode == Mode::RUN || m_mode == Mode::TEST)
         {
-            m_exec_thread = std::thread([this]() {
-                while (m_mode == Mode::RUN || m_mode == Mode::TEST)
+            // switching between RUN and TEST keeps the run thread
+            if (!m_exec_thread.joinable())
+            {
                 {
-                    Execute({});
+                    std::lock_guard<std::mutex> trigger_lock(m_trigger_mutex);
+                    m_running = true;
+                    m_next_tick = std::chrono::steady_clock::now() + m_trigger_interval;
                 }
-            });
+                m_exec_thread = std::thread([this]() { RunTriggers(); });
+            }
         } else
         {
-            m_exec_thread.join();
+            StopRunThread();
         }
         std::vector<std::future<void>> futures;
         for (auto& callback : m_on_mode_changed_callbacks)
@@ -285,35 +612,39 @@ public:
         }
     }
 
+    /**
+     * @brief Get the destination processors of the links from a processor, once per link
+     */
     std::vector<const Processor*> GetSuccessors(const uuids::uuid& proc_id) const
     {
         std::vector<const Processor*> successors;
-        auto it = m_proc_links.find(proc_id);
-        if (it != m_proc_links.end())
+        auto topology = GetTopology();
+        auto it = topology->index.find(proc_id);
+        if (it != topology->index.end())
         {
-            for (auto& link : it->second)
-            {
-                if (!link.m_dst.is_nil())
-                {
-                    successors.push_back(GetProcessor(link.m_dst));
-                }
-            }
+            auto first = topology->out_offsets[it->second];
+            auto last = topology->out_offsets[it->second + 1];
+            successors.reserve(last - first);
+            for (auto edge = first; edge < last; ++edge)
+                successors.push_back(topology->processors[topology->edges[edge].dst]);
         }
         return successors;
     }
 
+    /**
+     * @brief Get the source processors of the links to a processor, once per link
+     */
     std::vector<const Processor*> GetPredecessors(const uuids::uuid& proc_id) const
     {
         std::vector<const Processor*> predecessors;
-        for (auto& element : m_proc_links)
+        auto topology = GetTopology();
+        auto it = topology->index.find(proc_id);
+        if (it != topology->index.end())
         {
-            for (auto& link : element.second)
-            {
-                if (link.m_dst == proc_id)
-                {
-                    predecessors.push_back(GetProcessor(link.m_src));
-                }
-            }
+            auto in_edges = topology->InEdges(it->second);
+            predecessors.reserve(in_edges.size());
+            for (auto edge : in_edges)
+                predecessors.push_back(topology->processors[topology->edges[edge].src]);
         }
         return predecessors;
     }
@@ -348,7 +679,12 @@ public:
         return nullptr;
     }
 
-    void ResetExecutionStatus() { m_exec_status = SequenceExecutionStatus(); }
+    void ResetExecutionStatus()
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        WaitForPipeline();
+        m_exec_status = SequenceExecutionStatus();
+    }
 
     void MapProcessorInput(const uuids::uuid& proc_id, uint32_t seq_input_id, uint32_t proc_input_id)
     {
@@ -357,14 +693,1333 @@ public:
             m_proc_inputs[proc_id] = std::vector<std::pair<uint32_t, uint32_t>>();
         }
         m_proc_inputs[proc_id].push_back(std::make_pair(seq_input_id, proc_input_id));
+        InvalidateGraph();
     }
 
 protected:
-    // maps from a processor to links which have the key as the source processor
-    std::unordered_map<uuids::uuid, std::vector<Link>> m_proc_links;
-    std::thread m_exec_thread;
-    SequenceExecutionStatus m_exec_status;
-    std::unordered_map<uuids::uuid, std::vector<std::pair<uint32_t, uint32_t>>> m_proc_inputs;
+    /**
+     * @brief Results of a processor and what they were computed from
+     */
+    struct CacheEntry
+    {
+        bool valid{false};
+        uint64_t param_version{0};
+        // output versions of the processors of the incoming edges
+        std::vector<uint64_t> source_versions;
+        // values of the mapped sequence inputs
+        std::vector<cppbase::Variant> seq_inputs;
+        // shared with the executions reading them, so they're neither copied into the cache
+        // nor out of it
+        std::shared_ptr<const std::vector<cppbase::Variant>> results;
+        ExecutionStatus status;
+    };
+
+    /**
+     * @brief Dense index of the processors and their links in CSR arrays, so that looking up a
+     *   processor is O(1) and traversing its links O(degree). It's rebuilt lazily after the
+     *   topology changed.
+     */
+    struct Topology
+    {
+        struct Edge
+        {
+            uint32_t src;
+            uint32_t dst;
+            uint32_t src_id;
+            uint32_t dst_id;
+            // the last edge reading a result moves it instead of copying it
+            bool move;
+        };
+
+        struct EdgeRange
+        {
+            const uint32_t* first;
+            const uint32_t* last;
+
+            const uint32_t* begin() const { return first; }
+            const uint32_t* end() const { return last; }
+            size_t size() const { return static_cast<size_t>(last - first); }
+            uint32_t operator[](size_t i) const { return first[i]; }
+        };
+
+        std::vector<Processor*> processors;
+        std::unordered_map<uuids::uuid, uint32_t> index;
+        // every link between two processors is an edge, which has a slot in a Frame. The edges
+        // are grouped by source processor, the outgoing edges of processor i are the edges
+        // [out_offsets[i], out_offsets[i + 1]).
+        std::vector<Edge> edges;
+        std::vector<uint32_t> out_offsets;
+        // the incoming edges of processor i are in_edges[in_offsets[i], in_offsets[i + 1])
+        std::vector<uint32_t> in_offsets;
+        std::vector<uint32_t> in_edges;
+
+        EdgeRange InEdges(uint32_t i) const
+        {
+            return {in_edges.data() + in_offsets[i], in_edges.data() + in_offsets[i + 1]};
+        }
+    };
+
+    /**
+     * @brief The processors, links and input map compiled into a task graph. It's cached
+     *   between executions and rebuilt after the topology changed.
+     */
+    struct Graph : Topology
+    {
+        // per processor, the (sequence input, processor input) map
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> input_maps;
+        // per processor, the processors linked from it and the number linked into it
+        std::vector<std::vector<uint32_t>> successors;
+        std::vector<uint32_t> pred_counts;
+        // processor indices in topological order and the level of every processor, its
+        // longest path from a processor without links into it
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> levels;
+        // per processor, the number of inputs the processor is executed with and the number of
+        // results its outgoing edges read
+        std::vector<uint32_t> input_counts;
+        std::vector<uint32_t> result_counts;
+        // per processor, whether it's a serial stage when pipelined
+        std::vector<bool> serial_stages;
+        std::unique_ptr<tf::Taskflow> taskflow;
+        // limits how many processors of the sequence execute at a time
+        std::unique_ptr<tf::Semaphore> semaphore;
+        // per processor, the cached results and the number of times it was executed
+        std::vector<CacheEntry> cache;
+        std::vector<uint64_t> output_versions;
+        // per processor, the processor if it's a nested sequence, otherwise null
+        std::vector<Sequence*> nested;
+        // per processor, whether it's a switch and whether it can be pruned, which it can if
+        // it's linked from a switch or from a processor that can be pruned
+        std::vector<char> switches;
+        std::vector<char> prunable;
+        // per edge, whether the edge is on an untaken branch before the switches are executed
+        std::vector<char> untaken;
+    };
+
+    /**
+     * @brief State of one execution of the graph. Every processor's task only writes its own
+     *   entries and the slots of its outgoing edges, which it reads after its predecessors
+     *   have finished, so the tasks don't need to synchronize.
+     */
+    struct Frame
+    {
+        // the graph executed, which outlives the execution even if the sequence is compiled
+        // again meanwhile
+        Graph* graph{nullptr};
+        const std::vector<cppbase::Variant>* inputs{nullptr};
+        // values passed along the edges, moved into the inputs of the destination
+        std::vector<cppbase::Variant> slots;
+        // per processor
+        std::vector<std::vector<cppbase::Variant>> proc_inputs;
+        std::vector<std::vector<cppbase::Variant>> proc_results;
+        std::vector<ExecutionStatus> statuses;
+        std::atomic<bool> failed{false};
+        // whether the processors may reuse their cached results and which ones did
+        bool use_cache{false};
+        std::vector<char> cached;
+        // per processor, its results if they're stored in the cache, the slots of its
+        // outgoing edges stay empty then
+        std::vector<std::shared_ptr<const std::vector<cppbase::Variant>>> cached_results;
+        // per edge, whether it's on an untaken branch, and per processor, whether it was pruned
+        std::vector<char> untaken;
+        std::vector<char> pruned;
+        // profiling of the trigger
+        bool profiling{false};
+        uint64_t trigger{0};
+        int64_t start_ns{0};
+        std::vector<Profiler::ProcessorEvent> events;
+    };
+
+    /**
+     * @brief A trigger in flight through a pipelined sequence, guarded by m_pipeline_mutex
+     */
+    struct Token
+    {
+        Frame frame;
+        std::vector<cppbase::Variant> inputs;
+        uint64_t number{0};
+        bool busy{false};
+        // per processor, the number of predecessors not done with the token yet and whether
+        // the processor has been scheduled for the token
+        std::vector<uint32_t> waiting;
+        std::vector<bool> scheduled;
+        size_t remaining{0};
+        cppbase::TimerUs timer;
+        std::optional<std::chrono::steady_clock::time_point> trigger_time;
+    };
+
+    /**
+     * @brief State of one batch execution of the graph, see ExecuteBatch()
+     */
+    struct BatchFrame
+    {
+        const std::vector<BatchColumn::ConstPtr>* inputs{nullptr};
+        size_t batch_size{0};
+        bool failed{false};
+        // columns passed along the edges, shared by the processors linked from the same output
+        std::vector<BatchColumn::ConstPtr> slots;
+        // per processor, ids are kept for GetBatchResults() in case the graph is rebuilt
+        std::vector<std::vector<BatchColumn::ConstPtr>> proc_inputs;
+        std::vector<std::vector<BatchColumn::Ptr>> proc_results;
+        std::vector<ExecutionStatus> statuses;
+        std::vector<uuids::uuid> ids;
+    };
+
+    struct PendingTrigger
+    {
+        std::vector<cppbase::Variant> inputs;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    /**
+     * @brief Mark the cached graph outdated, the next execution rebuilds it
+     */
+    void InvalidateGraph()
+    {
+        m_graph_valid.store(false, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(m_topology_mutex);
+        m_topology.reset();
+    }
+
+    std::shared_ptr<const Topology> GetTopology() const
+    {
+        std::lock_guard<std::mutex> lock(m_topology_mutex);
+        if (!m_topology)
+            m_topology = BuildTopology();
+        return m_topology;
+    }
+
+    std::shared_ptr<const Topology> BuildTopology() const
+    {
+        auto topology = std::make_shared<Topology>();
+        auto& processors = topology->processors;
+        auto& index = topology->index;
+        auto& edges = topology->edges;
+        processors.reserve(m_processors.size());
+        for (auto& proc : m_processors)
+        {
+            if (!proc)
+                continue;
+            index.emplace(proc->GetId(), static_cast<uint32_t>(processors.size()));
+            processors.push_back(proc.get());
+        }
+
+        auto proc_count = static_cast<uint32_t>(processors.size());
+        topology->out_offsets.resize(proc_count + 1);
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            topology->out_offsets[i] = static_cast<uint32_t>(edges.size());
+            auto links = m_proc_links.find(processors[i]->GetId());
+            if (links == m_proc_links.end())
+                continue;
+            for (auto& link : links->second)
+            {
+                // links of removed processors are ignored
+                auto dst = index.find(link.m_dst);
+                if (link.m_dst.is_nil() || dst == index.end())
+                    continue;
+                edges.push_back({i, dst->second, link.m_src_id, link.m_dst_id, false});
+            }
+            // the last edge reading a result of the processor moves it
+            auto first = edges.begin() + topology->out_offsets[i];
+            for (auto it = edges.rbegin(); it.base() != first; ++it)
+            {
+                it->move = std::none_of(edges.rbegin(), it, [&it](const Topology::Edge& other) {
+                    return other.src_id == it->src_id;
+                });
+            }
+        }
+        topology->out_offsets[proc_count] = static_cast<uint32_t>(edges.size());
+
+        // counting sort of the edges by destination
+        topology->in_offsets.assign(proc_count + 1, 0);
+        for (auto& edge : edges)
+            topology->in_offsets[edge.dst + 1]++;
+        for (uint32_t i = 0; i < proc_count; ++i)
+            topology->in_offsets[i + 1] += topology->in_offsets[i];
+        topology->in_edges.resize(edges.size());
+        auto next = topology->in_offsets;
+        for (uint32_t edge = 0; edge < edges.size(); ++edge)
+            topology->in_edges[next[edges[edge].dst]++] = edge;
+        return topology;
+    }
+
+    // called with m_execute_mutex locked while no trigger is in flight
+    Graph& GetGraph()
+    {
+        bool valid = m_graph_valid.exchange(true, std::memory_order_acq_rel);
+        if (!valid || !m_graph)
+        {
+            try
+            {
+                m_graph = BuildGraph();
+                // the tokens and the serial stages of the pipeline refer to the previous graph,
+                // the next submitted trigger resets them
+                m_tokens.clear();
+            } catch (...)
+            {
+                // the next execution compiles the sequence again and fails the same way
+                m_graph.reset();
+                m_graph_valid.store(false, std::memory_order_release);
+                throw;
+            }
+        }
+        return *m_graph;
+    }
+
+    /**
+     * @brief Check the links and the input map against the processors' input and output types
+     * @throw CompileError naming the processors at fault
+     */
+    void ValidateGraph(const Graph& graph) const
+    {
+        const auto& index = graph.index;
+        auto name = [](const Processor* proc) { return proc->GetName(); };
+        for (auto& element : m_proc_links)
+        {
+            for (auto& link : element.second)
+            {
+                auto src = index.find(link.m_src);
+                auto dst = index.find(link.m_dst);
+                if (src == index.end() || dst == index.end())
+                {
+                    std::vector<std::string> names;
+                    if (src != index.end())
+                        names.push_back(name(graph.processors[src->second]));
+                    if (dst != index.end())
+                        names.push_back(name(graph.processors[dst->second]));
+                    throw CompileError("Link to or from a processor not in the sequence", names);
+                }
+            }
+        }
+
+        for (auto& edge : graph.edges)
+        {
+            auto* src = graph.processors[edge.src];
+            auto* dst = graph.processors[edge.dst];
+            auto outputs = src->GetOutputTypes();
+            auto inputs = dst->GetInputTypes();
+            // processors that don't declare their outputs may have any number of results
+            if (edge.dst_id >= inputs.size() ||
+                (!outputs.empty() && edge.src_id >= outputs.size()))
+                throw CompileError("Link to or from an undeclared input or output",
+                                   {name(src), name(dst)});
+            if (!outputs.empty() && outputs[edge.src_id].second != inputs[edge.dst_id].second)
+                throw CompileError("Link from output " + outputs[edge.src_id].first +
+                                       " to input " + inputs[edge.dst_id].first +
+                                       " of a different type",
+                                   {name(src), name(dst)});
+        }
+
+        auto seq_inputs = GetInputTypes();
+        for (uint32_t i = 0; i < graph.processors.size(); ++i)
+        {
+            auto* proc = graph.processors[i];
+            auto inputs = proc->GetInputTypes();
+            for (auto& input : graph.input_maps[i])
+            {
+                if (input.first >= seq_inputs.size() || input.second >= inputs.size())
+                    throw CompileError("Undeclared input in the input map", {name(proc)});
+                if (seq_inputs[input.first].second != inputs[input.second].second)
+                    throw CompileError("Sequence input " + seq_inputs[input.first].first +
+                                           " mapped to input " + inputs[input.second].first +
+                                           " of a different type",
+                                       {name(proc)});
+            }
+        }
+    }
+
+    std::unique_ptr<Graph> BuildGraph()
+    {
+        auto graph = std::make_unique<Graph>();
+        static_cast<Topology&>(*graph) = *GetTopology();
+        const auto& index = graph->index;
+        auto proc_count = static_cast<uint32_t>(graph->processors.size());
+        graph->input_maps.resize(proc_count);
+
+        // successors without duplicates, processors linked more than once depend once
+        std::vector<uint32_t> in_degree(proc_count, 0);
+        std::vector<std::vector<uint32_t>> successors(proc_count);
+        std::vector<uint32_t> last_src(proc_count, proc_count);
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            for (auto edge = graph->out_offsets[i]; edge < graph->out_offsets[i + 1]; ++edge)
+            {
+                auto dst = graph->edges[edge].dst;
+                if (last_src[dst] == i)
+                    continue;
+                last_src[dst] = i;
+                successors[i].push_back(dst);
+                in_degree[dst]++;
+            }
+        }
+        for (auto& element : m_proc_inputs)
+        {
+            auto it = index.find(element.first);
+            if (it != index.end())
+                graph->input_maps[it->second] = element.second;
+        }
+        ValidateGraph(*graph);
+
+        // the executions neither resize the inputs nor check the results of the processors
+        // per link
+        graph->input_counts.resize(proc_count);
+        graph->result_counts.assign(proc_count, 0);
+        for (uint32_t i = 0; i < proc_count; ++i)
+            graph->input_counts[i] = static_cast<uint32_t>(graph->processors[i]->GetInputCount());
+        for (auto& edge : graph->edges)
+        {
+            auto& count = graph->result_counts[edge.src];
+            count = std::max(count, edge.src_id + 1);
+        }
+
+        graph->cache.resize(proc_count);
+        graph->output_versions.resize(proc_count);
+        graph->pred_counts = in_degree;
+        graph->serial_stages.resize(proc_count);
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            auto it = m_stage_types.find(graph->processors[i]->GetId());
+            graph->serial_stages[i] = it == m_stage_types.end() || it->second == StageType::SERIAL;
+        }
+
+        // Kahn's algorithm, processors left over are part of a cycle or downstream of one
+        graph->levels.assign(proc_count, 0);
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            if (in_degree[i] == 0)
+                graph->order.push_back(i);
+        }
+        for (size_t i = 0; i < graph->order.size(); ++i)
+        {
+            auto src = graph->order[i];
+            for (auto dst : successors[src])
+            {
+                graph->levels[dst] = std::max(graph->levels[dst], graph->levels[src] + 1);
+                if (--in_degree[dst] == 0)
+                    graph->order.push_back(dst);
+            }
+        }
+        if (graph->order.size() != proc_count)
+        {
+            // peel the processors downstream of the cycles off, the ones left are on a cycle
+            std::vector<uint32_t> out_degree(proc_count, 0);
+            std::vector<uint32_t> sinks;
+            for (uint32_t i = 0; i < proc_count; ++i)
+            {
+                if (in_degree[i] == 0)
+                    continue;
+                for (auto edge = graph->out_offsets[i]; edge < graph->out_offsets[i + 1]; ++edge)
+                    out_degree[i] += in_degree[graph->edges[edge].dst] != 0;
+                if (out_degree[i] == 0)
+                    sinks.push_back(i);
+            }
+            for (size_t i = 0; i < sinks.size(); ++i)
+            {
+                auto dst = sinks[i];
+                in_degree[dst] = 0;
+                for (auto edge : graph->InEdges(dst))
+                {
+                    auto src = graph->edges[edge].src;
+                    if (in_degree[src] != 0 && out_degree[src] != 0 && --out_degree[src] == 0)
+                        sinks.push_back(src);
+                }
+            }
+            std::vector<std::string> names;
+            for (uint32_t i = 0; i < proc_count; ++i)
+            {
+                if (in_degree[i] != 0)
+                    names.push_back(graph->processors[i]->GetName());
+            }
+            throw CompileError("Sequence contains a cycle", names);
+        }
+
+        // the edges from a switch are untaken until the switch takes them
+        graph->switches.resize(proc_count);
+        graph->prunable.assign(proc_count, false);
+        graph->untaken.assign(graph->edges.size(), false);
+        for (uint32_t i = 0; i < proc_count; ++i)
+            graph->switches[i] = dynamic_cast<SwitchProcessor*>(graph->processors[i]) != nullptr;
+        for (auto src : graph->order)
+        {
+            if (!graph->switches[src] && !graph->prunable[src])
+                continue;
+            for (auto edge = graph->out_offsets[src]; edge < graph->out_offsets[src + 1]; ++edge)
+            {
+                graph->prunable[graph->edges[edge].dst] = true;
+                graph->untaken[edge] = graph->switches[src];
+            }
+        }
+
+        graph->successors = std::move(successors);
+        graph->nested.resize(proc_count);
+        for (uint32_t i = 0; i < proc_count; ++i)
+            graph->nested[i] = dynamic_cast<Sequence*>(graph->processors[i]);
+        graph->taskflow = std::make_unique<tf::Taskflow>(uuids::to_string(m_id));
+        if (m_concurrency > 0 && m_concurrency < GetExecutor().num_workers())
+            graph->semaphore = std::make_unique<tf::Semaphore>(m_concurrency);
+        EmplaceTasks(*graph->taskflow, *graph, m_frame);
+        return graph;
+    }
+
+    /**
+     * @brief Emplace a task per processor of the graph, which executes it with the frame, and
+     *   make every task precede the ones of its successors
+     */
+    void EmplaceTasks(tf::FlowBuilder& flow, Graph& graph, Frame& frame)
+    {
+        auto proc_count = static_cast<uint32_t>(graph.processors.size());
+        std::vector<tf::Task> tasks;
+        tasks.reserve(proc_count);
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            if (graph.nested[i])
+            {
+                tasks.push_back(flow.emplace([this, &frame, i](tf::Subflow& subflow) {
+                    ExecuteProcessor(frame, i, &subflow);
+                }));
+            } else
+            {
+                tasks.push_back(flow.emplace([this, &frame, i]() { ExecuteProcessor(frame, i); }));
+            }
+            tasks.back().name(graph.processors[i]->GetName());
+            if (graph.semaphore)
+            {
+                tasks.back().acquire(*graph.semaphore);
+                tasks.back().release(*graph.semaphore);
+            }
+        }
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            for (auto dst : graph.successors[i])
+                tasks[i].precede(tasks[dst]);
+        }
+    }
+
+    /**
+     * @brief Execute the compiled graph with the inputs
+     */
+    ExecutionStatus ExecuteGraph(const std::vector<cppbase::Variant>& inputs)
+    {
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        WaitForPipeline();
+
+        m_exec_status.trigger_count++;
+
+        if (!PreExecute(inputs))
+        {
+            return m_exec_status;
+        }
+
+        auto& graph = GetGraph();
+        // the executions in subflows share the cache entries with this one, see ExecuteSubflow()
+        ResetFrame(m_frame, graph, inputs, m_caching && m_subflows == 0);
+
+        // A sequence executed by a processor of another sequence already runs on a worker of
+        // the executor, waiting for the executor there could block all of its workers. With a
+        // concurrency of 1 the processors execute one after the other anyway, which doesn't
+        // need to hand them over to the executor.
+        auto& executor = GetExecutor();
+        if (executor.this_worker_id() >= 0 || m_concurrency == 1)
+        {
+            for (auto index : graph.order)
+                ExecuteProcessor(m_frame, index);
+        } else
+        {
+            executor.run(*graph.taskflow).wait();
+        }
+        std::vector<cppbase::Variant> seq_results;
+        return FinishExecution(m_frame, seq_results);
+    }
+
+    /**
+     * @brief Execute the graph nested in the subflow of the parent's task, with a frame of its
+     *   own. The worker joining the subflow executes other tasks meanwhile, which may execute
+     *   the sequence again, so no mutex is held while it's joined.
+     */
+    ExecutionStatus ExecuteSubflow(tf::Subflow& subflow,
+                                   const std::vector<cppbase::Variant>& inputs,
+                                   std::vector<cppbase::Variant>& results)
+    {
+        std::shared_ptr<Graph> graph;
+        std::unique_ptr<Frame> frame;
+        {
+            std::lock_guard<std::mutex> lock(m_execute_mutex);
+            WaitForPipeline();
+
+            m_exec_status.trigger_count++;
+
+            if (!PreExecute(inputs))
+            {
+                results = GetResults();
+                return m_exec_status;
+            }
+
+            GetGraph();
+            graph = m_graph;
+            if (m_spare_frames.empty())
+            {
+                frame = std::make_unique<Frame>();
+            } else
+            {
+                frame = std::move(m_spare_frames.back());
+                m_spare_frames.pop_back();
+            }
+            // only one execution at a time uses the cache entries of the graph
+            ResetFrame(*frame, *graph, inputs, m_caching && m_subflows == 0);
+            m_subflows++;
+        }
+
+        try
+        {
+            EmplaceTasks(subflow, *graph, *frame);
+            subflow.join();
+        } catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_execute_mutex);
+            m_subflows--;
+            m_spare_frames.push_back(std::move(frame));
+            throw;
+        }
+
+        std::lock_guard<std::mutex> lock(m_execute_mutex);
+        WaitForPipeline();
+        m_subflows--;
+        auto status = FinishExecution(*frame, results);
+        m_spare_frames.push_back(std::move(frame));
+        return status;
+    }
+
+    /**
+     * @brief Collect the results and the status of an execution of the graph and notify the
+     *   callbacks, under m_execute_mutex
+     * @param results The results of the execution, ordered like the processors, whatever
+     *   order they were executed in
+     */
+    ExecutionStatus FinishExecution(Frame& frame, std::vector<cppbase::Variant>& results)
+    {
+        const auto& graph = *frame.graph;
+        auto proc_count = graph.processors.size();
+        std::vector<std::future<void>> futures;
+        if (frame.profiling)
+            AddProfilerTrigger(frame);
+
+        results.clear();
+        results.reserve(proc_count);
+        for (auto& status : frame.statuses)
+            results.emplace_back(status);
+        PostExecute(results);
+        {
+            std::lock_guard<std::mutex> lock(m_results_mutex);
+            m_results = results;
+        }
+
+        m_exec_status = Processor::GetExecutionStatus();
+        m_exec_status.cached_processors.clear();
+        m_exec_status.pruned_processors.clear();
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            if (frame.cached[i])
+                m_exec_status.cached_processors.push_back(graph.processors[i]->GetId());
+            if (frame.pruned[i])
+                m_exec_status.pruned_processors.push_back(graph.processors[i]->GetId());
+        }
+        m_exec_status.exec_count++;
+        m_exec_status.exec_status =
+            frame.failed.load(std::memory_order_relaxed) ? ExecStatus::FAIL : ExecStatus::PASS;
+        if (m_exec_status.exec_status == ExecStatus::PASS)
+        {
+            m_exec_status.ok_count++;
+        } else if (m_exec_status.exec_status == ExecStatus::FAIL)
+        {
+            m_exec_status.ng_count++;
+        }
+
+        for (auto& callback : m_on_complete_callbacks)
+        {
+            futures.push_back(std::async(std::launch::async, callback, m_results));
+        }
+
+        return m_exec_status;
+    }
+
+    /**
+     * @brief Execute a processor of the cached graph and pass its results on to the slots of
+     *   its outgoing edges
+     * @param subflow Subflow of the processor's task if it's a nested sequence, see
+     *   ExecuteNested()
+     */
+    void ExecuteProcessor(Frame& frame, uint32_t index, tf::Subflow* subflow = nullptr)
+    {
+        auto& graph = *frame.graph;
+        auto* proc = graph.processors[index];
+        auto& proc_inputs = frame.proc_inputs[index];
+        ExecutionStatus status;
+        if (graph.prunable[index] && IsPruned(frame, index))
+        {
+            PruneProcessor(frame, index);
+            return;
+        }
+        int64_t start_ns = frame.profiling ? m_profiler.Now() : 0;
+        int64_t copied_ns = start_ns;
+        try
+        {
+            // Initialize processor's inputs with sequence's inputs based on the processor input
+            // map in the sequence, then overwrite them with the values of the links linked into
+            // the processor. Links from processors that didn't pass leave their slots empty,
+            // links from processors whose results are cached are read from the cache entry.
+            // The compiled graph guarantees that the mapped and linked inputs exist, only the
+            // inputs the sequence is executed with may be fewer than declared.
+            // A processor reusing its cached results doesn't read its inputs at all.
+            auto gather_inputs = [&]() {
+                proc_inputs.clear();
+                proc_inputs.resize(graph.input_counts[index]);
+                for (auto& input : graph.input_maps[index])
+                {
+                    if (input.first < frame.inputs->size())
+                        proc_inputs[input.second] = (*frame.inputs)[input.first];
+                }
+                for (auto edge : graph.InEdges(index))
+                {
+                    const auto& link = graph.edges[edge];
+                    auto& slot = frame.slots[edge];
+                    const auto& source = frame.cached_results[link.src];
+                    if (slot.IsValid())
+                        proc_inputs[link.dst_id] = std::move(slot);
+                    else if (source && (*source)[link.src_id].IsValid())
+                        proc_inputs[link.dst_id] = (*source)[link.src_id];
+                }
+                if (frame.profiling)
+                    copied_ns = m_profiler.Now();
+            };
+
+            auto& results = frame.proc_results[index];
+            auto execute = [&]() {
+                gather_inputs();
+                if (subflow)
+                    return graph.nested[index]->ExecuteNested(*subflow, proc_inputs, results);
+                return proc->ExecuteReentrant(proc_inputs, results);
+            };
+            // results of a cacheable processor are read from the cache entry they're stored in
+            std::shared_ptr<const std::vector<cppbase::Variant>> cached;
+            if (frame.use_cache && IsCached(frame, index))
+            {
+                const auto& entry = graph.cache[index];
+                cached = entry.results;
+                status = entry.status;
+                frame.cached[index] = true;
+            } else if (frame.use_cache)
+            {
+                auto& entry = graph.cache[index];
+                entry.valid = false;
+                graph.output_versions[index]++;
+                auto param_version = proc->GetParamVersion();
+                status = execute();
+                if (status.exec_status == ExecStatus::PASS && proc->IsCacheable())
+                    cached = UpdateCache(frame, index, param_version, std::move(results), status);
+            } else
+            {
+                status = execute();
+            }
+            const auto& outputs = cached ? *cached : results;
+            auto out_first = graph.out_offsets[index];
+            auto out_last = graph.out_offsets[index + 1];
+            if (graph.switches[index] && status.exec_status == ExecStatus::PASS)
+            {
+                // a switch only has results for its taken branch
+                for (auto edge = out_first; edge < out_last; ++edge)
+                {
+                    auto src_id = graph.edges[edge].src_id;
+                    frame.untaken[edge] = src_id >= outputs.size() || !outputs[src_id].IsValid();
+                }
+            }
+            if (status.exec_status == ExecStatus::PASS && out_first != out_last)
+            {
+                // Results are handed to the linked processors by moving them along the last link
+                // reading them, and copying them along the others. Cached results stay in the
+                // cache entry, only the linked processors that execute copy them. Payloads
+                // wrapped in a CowPtr are shared instead of copied.
+                if (outputs.size() < graph.result_counts[index])
+                {
+                    std::cerr << "Link source id is out of results range, results.size() = "
+                              << outputs.size() << std::endl;
+                    throw std::out_of_range("Link source id is out of results range");
+                }
+                if (cached)
+                {
+                    frame.cached_results[index] = std::move(cached);
+                } else
+                {
+                    for (auto edge = out_first; edge < out_last; ++edge)
+                    {
+                        auto src_id = graph.edges[edge].src_id;
+                        if (graph.edges[edge].move)
+                            frame.slots[edge] = std::move(results[src_id]);
+                        else
+                            frame.slots[edge] = results[src_id];
+                    }
+                }
+            }
+        } catch (...)
+        {
+            frame.failed.store(true, std::memory_order_relaxed);
+            if (status.id.is_nil())
+                status = proc->GetExecutionStatus();
+        }
+        if (frame.profiling)
+            RecordProcessorEvent(frame, index, start_ns, copied_ns);
+        frame.statuses[index] = std::move(status);
+    }
+
+    /**
+     * @brief Execute a processor of the cached graph for a batch and pass its result columns on
+     *   to the slots of its outgoing edges
+     */
+    void ExecuteBatchProcessor(BatchFrame& frame, uint32_t index)
+    {
+        const auto& graph = *m_graph;
+        auto* proc = graph.processors[index];
+        auto& columns = frame.proc_inputs[index];
+        auto& results = frame.proc_results[index];
+        ExecutionStatus status;
+        frame.ids[index] = proc->GetId();
+        try
+        {
+            // like ExecuteProcessor(), the columns of the links replace the mapped sequence
+            // inputs, inputs with neither are columns of empty values
+            columns.assign(graph.input_counts[index], nullptr);
+            for (auto& input : graph.input_maps[index])
+            {
+                if (input.first < frame.inputs->size())
+                    columns[input.second] = (*frame.inputs)[input.first];
+            }
+            for (auto edge : graph.InEdges(index))
+            {
+                auto& slot = frame.slots[edge];
+                if (slot)
+                    columns[graph.edges[edge].dst_id] = std::move(slot);
+            }
+            for (auto& column : columns)
+            {
+                if (!column)
+                    column = std::make_shared<VariantColumn>(frame.batch_size);
+            }
+
+            results.clear();
+            status = proc->ExecuteBatch(frame.batch_size, columns, results);
+            if (status.exec_status == ExecStatus::PASS)
+            {
+                if (results.size() < graph.result_counts[index])
+                    throw std::out_of_range("Link source id is out of results range");
+                for (auto edge = graph.out_offsets[index]; edge < graph.out_offsets[index + 1];
+                     ++edge)
+                    frame.slots[edge] = results[graph.edges[edge].src_id];
+            }
+        } catch (...)
+        {
+            frame.failed = true;
+            if (status.id.is_nil())
+                status = proc->GetExecutionStatus();
+        }
+        frame.statuses[index] = std::move(status);
+    }
+
+    void ResetFrame(Frame& frame, Graph& graph, const std::vector<cppbase::Variant>& inputs,
+                    bool use_cache)
+    {
+        auto proc_count = graph.processors.size();
+        frame.graph = &graph;
+        frame.inputs = &inputs;
+        frame.failed.store(false, std::memory_order_relaxed);
+        frame.proc_inputs.resize(proc_count);
+        frame.proc_results.resize(proc_count);
+        frame.statuses.resize(proc_count);
+        frame.slots.resize(graph.edges.size());
+        for (auto& slot : frame.slots)
+            slot.Clear();
+        frame.use_cache = use_cache;
+        frame.cached.assign(proc_count, false);
+        frame.cached_results.assign(proc_count, nullptr);
+        frame.untaken = graph.untaken;
+        frame.pruned.assign(proc_count, false);
+        frame.profiling = m_profiling;
+        if (frame.profiling)
+        {
+            frame.trigger = m_exec_status.trigger_count;
+            frame.start_ns = m_profiler.Now();
+            frame.events.assign(proc_count, {});
+        }
+    }
+
+    void AddProfilerTrigger(Frame& frame)
+    {
+        m_profiler.AddTrigger(
+            {frame.trigger, frame.start_ns, m_profiler.Now(), std::move(frame.events)});
+    }
+
+    /**
+     * @brief Record the execution of a processor, which was ready once the processors linked
+     *   into it were done
+     */
+    void RecordProcessorEvent(Frame& frame, uint32_t index, int64_t start_ns, int64_t copied_ns)
+    {
+        const auto& graph = *frame.graph;
+        auto& event = frame.events[index];
+        event.id = graph.processors[index]->GetId();
+        event.name = graph.processors[index]->GetName();
+        event.ready_ns = frame.start_ns;
+        for (auto edge : graph.InEdges(index))
+            event.ready_ns = std::max(event.ready_ns, frame.events[graph.edges[edge].src].end_ns);
+        event.start_ns = start_ns;
+        event.input_copy_ns = copied_ns - start_ns;
+        event.worker = GetExecutor().this_worker_id();
+        event.cached = frame.use_cache && frame.cached[index];
+        event.end_ns = m_profiler.Now();
+    }
+
+    /**
+     * @brief Check if all links into a processor are on untaken branches
+     */
+    bool IsPruned(const Frame& frame, uint32_t index) const
+    {
+        auto in_edges = frame.graph->InEdges(index);
+        return std::all_of(in_edges.begin(), in_edges.end(),
+                           [&frame](uint32_t edge) { return frame.untaken[edge]; });
+    }
+
+    /**
+     * @brief Skip a processor on an untaken branch without executing it, the links from it are
+     *   on the untaken branch as well
+     */
+    void PruneProcessor(Frame& frame, uint32_t index)
+    {
+        auto& graph = *frame.graph;
+        frame.pruned[index] = true;
+        for (auto edge = graph.out_offsets[index]; edge < graph.out_offsets[index + 1]; ++edge)
+            frame.untaken[edge] = true;
+        // the processors it's linked to must not reuse results computed from its last results
+        if (frame.use_cache)
+            graph.output_versions[index]++;
+        auto& status = frame.statuses[index];
+        status = ExecutionStatus();
+        status.id = graph.processors[index]->GetId();
+        status.exec_status = ExecStatus::SKIPPED;
+    }
+
+    bool IsCached(const Frame& frame, uint32_t index) const
+    {
+        const auto& graph = *frame.graph;
+        const auto& entry = graph.cache[index];
+        auto* proc = graph.processors[index];
+        if (!entry.valid || !proc->IsCacheable() ||
+            entry.param_version != proc->GetParamVersion() || !proc->GetExecutable())
+            return false;
+
+        auto in_edges = graph.InEdges(index);
+        for (size_t i = 0; i < in_edges.size(); ++i)
+        {
+            if (entry.source_versions[i] != graph.output_versions[graph.edges[in_edges[i]].src])
+                return false;
+        }
+        const auto& input_map = graph.input_maps[index];
+        for (size_t i = 0; i < input_map.size(); ++i)
+        {
+            auto seq_index = input_map[i].first;
+            if (seq_index < frame.inputs->size() ? entry.seq_inputs[i] != (*frame.inputs)[seq_index]
+                                                 : entry.seq_inputs[i].IsValid())
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Store the results of a processor in its cache entry
+     * @return the cached results
+     */
+    std::shared_ptr<const std::vector<cppbase::Variant>> UpdateCache(
+        const Frame& frame, uint32_t index, uint64_t param_version,
+        std::vector<cppbase::Variant>&& results, const ExecutionStatus& status)
+    {
+        auto& graph = *frame.graph;
+        auto& entry = graph.cache[index];
+        entry.param_version = param_version;
+        entry.source_versions.clear();
+        for (auto edge : graph.InEdges(index))
+            entry.source_versions.push_back(graph.output_versions[graph.edges[edge].src]);
+        entry.seq_inputs.clear();
+        for (auto& input : graph.input_maps[index])
+        {
+            if (input.first < frame.inputs->size())
+                entry.seq_inputs.push_back((*frame.inputs)[input.first]);
+            else
+                entry.seq_inputs.emplace_back();
+        }
+        entry.results = std::make_shared<const std::vector<cppbase::Variant>>(std::move(results));
+        entry.status = status;
+        entry.valid = true;
+        return entry.results;
+    }
+
+    static void ClearCache(Graph& graph)
+    {
+        for (auto& entry : graph.cache)
+            entry = CacheEntry();
+    }
+
+    /**
+     * @brief Submit a trigger to the pipeline, or execute the sequence if it isn't pipelined
+     * @param trigger_time Time of the trigger if its latency is recorded
+     */
+    void SubmitTrigger(const std::vector<cppbase::Variant>& inputs,
+                       std::optional<std::chrono::steady_clock::time_point> trigger_time)
+    {
+        // the graph is only compiled with m_execute_mutex locked, and the executions wait for
+        // the pipeline to drain with it locked, so none of them overlap a trigger in flight
+        std::unique_lock<std::mutex> execute_lock(m_execute_mutex);
+        if (m_max_tokens == 0)
+        {
+            execute_lock.unlock();
+            Execute(inputs);
+            if (trigger_time)
+                RecordTriggerLatency(*trigger_time);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_pipeline_mutex);
+        m_exec_status.trigger_count++;
+        if (!PreExecute(inputs))
+        {
+            return;
+        }
+
+        // the graph and the pipeline are only reset when no trigger is in flight
+        if (!m_graph_valid.load(std::memory_order_acquire) || !m_graph ||
+            m_tokens.size() != m_max_tokens)
+        {
+            m_pipeline_condition.wait(lock, [this] { return m_in_flight == 0; });
+            GetGraph();
+            m_tokens.clear();
+            for (uint32_t i = 0; i < m_max_tokens; ++i)
+                m_tokens.push_back(std::make_unique<Token>());
+            m_stage_next.assign(m_graph->processors.size(), m_next_token);
+        }
+
+        Token* token = nullptr;
+        m_pipeline_condition.wait(lock, [this, &token] {
+            token = m_tokens[m_next_token % m_tokens.size()].get();
+            return !token->busy;
+        });
+
+        auto& graph = *m_graph;
+        auto proc_count = graph.processors.size();
+        token->busy = true;
+        token->trigger_time = trigger_time;
+        token->number = m_next_token++;
+        token->timer.Start();
+        token->inputs = inputs;
+        ResetFrame(token->frame, graph, token->inputs, false);
+        token->waiting = graph.pred_counts;
+        token->scheduled.assign(proc_count, false);
+        token->remaining = proc_count;
+        m_in_flight++;
+        if (proc_count == 0)
+        {
+            auto seq_results = CompleteToken(*token);
+            lock.unlock();
+            execute_lock.unlock();
+            InvokeOnComplete(seq_results);
+            return;
+        }
+
+        std::vector<uint32_t> ready;
+        for (uint32_t i = 0; i < proc_count; ++i)
+        {
+            if (IsStageReady(*token, i))
+            {
+                token->scheduled[i] = true;
+                ready.push_back(i);
+            }
+        }
+        lock.unlock();
+        execute_lock.unlock();
+        for (auto index : ready)
+            ScheduleStage(*token, index);
+    }
+
+    // called with m_trigger_mutex locked
+    bool EnqueueTrigger(std::vector<cppbase::Variant>&& inputs,
+                        std::chrono::steady_clock::time_point time)
+    {
+        if (m_trigger_queue.size() < m_trigger_capacity)
+        {
+            m_trigger_queue.push_back({std::move(inputs), time});
+            return true;
+        }
+
+        m_dropped_triggers++;
+        if (m_trigger_policy == TriggerPolicy::COALESCE)
+        {
+            m_trigger_queue.back().inputs = std::move(inputs);
+        } else
+        {
+            m_trigger_queue.pop_front();
+            m_trigger_queue.push_back({std::move(inputs), time});
+        }
+        return false;
+    }
+
+    /**
+     * @brief Body of the run thread, executes the sequence for the triggers and the timer ticks,
+     *   sleeps while there's none
+     */
+    void RunTriggers()
+    {
+        using clock = std::chrono::steady_clock;
+        std::unique_lock<std::mutex> lock(m_trigger_mutex);
+        while (m_running)
+        {
+            bool timer = m_trigger_interval.count() > 0;
+            if (timer)
+            {
+                auto now = clock::now();
+                if (now >= m_next_tick)
+                {
+                    EnqueueTrigger({}, m_next_tick);
+                    m_next_tick += m_trigger_interval;
+                    if (m_next_tick <= now)
+                        m_next_tick = now + m_trigger_interval;
+                }
+            }
+            if (m_trigger_queue.empty())
+            {
+                if (timer)
+                    m_trigger_condition.wait_until(lock, m_next_tick);
+                else
+                    m_trigger_condition.wait(lock);
+                continue;
+            }
+
+            std::vector<PendingTrigger> triggers;
+            auto batch_size = m_max_tokens == 0 ? m_batch_size : 1;
+            while (!m_trigger_queue.empty() && triggers.size() < batch_size)
+            {
+                triggers.push_back(std::move(m_trigger_queue.front()));
+                m_trigger_queue.pop_front();
+            }
+            lock.unlock();
+            try
+            {
+                if (triggers.size() == 1)
+                    SubmitTrigger(triggers[0].inputs, triggers[0].time);
+                else
+                    ExecuteTriggerBatch(triggers);
+            } catch (const std::exception& e)
+            {
+                std::cerr << "Sequence " << m_name << " failed to execute: " << e.what()
+                          << std::endl;
+            }
+            lock.lock();
+        }
+        m_trigger_queue.clear();
+        lock.unlock();
+        WaitForPipeline();
+    }
+
+    /**
+     * @brief Execute triggers as one batch, the inputs of the triggers become the columns of
+     *   the sequence inputs
+     */
+    void ExecuteTriggerBatch(std::vector<PendingTrigger>& triggers)
+    {
+        size_t input_count = 0;
+        for (auto& trigger : triggers)
+            input_count = std::max(input_count, trigger.inputs.size());
+        std::vector<BatchColumn::ConstPtr> columns;
+        columns.reserve(input_count);
+        for (size_t i = 0; i < input_count; ++i)
+        {
+            std::vector<cppbase::Variant> values(triggers.size());
+            for (size_t j = 0; j < triggers.size(); ++j)
+            {
+                if (i < triggers[j].inputs.size())
+                    values[j] = std::move(triggers[j].inputs[i]);
+            }
+            columns.push_back(MakeColumn(std::move(values)));
+        }
+        std::vector<BatchColumn::Ptr> outputs;
+        ExecuteBatch(triggers.size(), columns, outputs);
+        for (auto& trigger : triggers)
+            RecordTriggerLatency(trigger.time);
+    }
+
+    void StopRunThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_trigger_mutex);
+            m_running = false;
+        }
+        m_trigger_condition.notify_all();
+        if (m_exec_thread.joinable())
+            m_exec_thread.join();
+    }
+
+    void RecordTriggerLatency(std::chrono::steady_clock::time_point trigger_time)
+    {
+        auto latency = std::chrono::steady_clock::now() - trigger_time;
+        std::lock_guard<std::mutex> lock(m_latency_mutex);
+        m_trigger_latency.Record(std::chrono::duration<double, std::micro>(latency).count());
+    }
+
+    // called with m_pipeline_mutex locked
+    bool IsStageReady(const Token& token, uint32_t index) const
+    {
+        return token.waiting[index] == 0 && !token.scheduled[index] &&
+               (!m_graph->serial_stages[index] || m_stage_next[index] == token.number);
+    }
+
+    void ScheduleStage(Token& token, uint32_t index)
+    {
+        GetExecutor().silent_async([this, &token, index]() { ExecuteStage(token, index); });
+    }
+
+    /**
+     * @brief Execute a processor for a token, then schedule the successors that are ready for
+     *   the token, and the next token if it waits for a serial stage
+     */
+    void ExecuteStage(Token& token, uint32_t index)
+    {
+        ExecuteProcessor(token.frame, index);
+
+        std::vector<std::pair<Token*, uint32_t>> ready;
+        std::optional<std::vector<cppbase::Variant>> seq_results;
+        {
+            std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+            const auto& graph = *m_graph;
+            for (auto succ : graph.successors[index])
+            {
+                token.waiting[succ]--;
+                if (IsStageReady(token, succ))
+                {
+                    token.scheduled[succ] = true;
+                    ready.emplace_back(&token, succ);
+                }
+            }
+            if (graph.serial_stages[index])
+            {
+                m_stage_next[index] = token.number + 1;
+                auto& next = *m_tokens[(token.number + 1) % m_tokens.size()];
+                if (next.busy && next.number == token.number + 1 && IsStageReady(next, index))
+                {
+                    next.scheduled[index] = true;
+                    ready.emplace_back(&next, index);
+                }
+            }
+            if (--token.remaining == 0)
+                seq_results = CompleteToken(token);
+        }
+        for (auto& stage : ready)
+            ScheduleStage(*stage.first, stage.second);
+        if (seq_results)
+            InvokeOnComplete(*seq_results);
+    }
+
+    // called with m_pipeline_mutex locked, frees the token
+    std::vector<cppbase::Variant> CompleteToken(Token& token)
+    {
+        if (token.frame.profiling)
+            AddProfilerTrigger(token.frame);
+        if (token.trigger_time)
+            RecordTriggerLatency(*token.trigger_time);
+
+        std::vector<cppbase::Variant> seq_results;
+        seq_results.reserve(token.frame.statuses.size());
+        for (auto& status : token.frame.statuses)
+            seq_results.emplace_back(status);
+        {
+            std::lock_guard<std::mutex> lock(m_results_mutex);
+            m_results = seq_results;
+        }
+
+        m_exec_status.exec_time_us = static_cast<double>(token.timer.Elapsed());
+        m_exec_status.exec_count++;
+        m_exec_status.exec_status = token.frame.failed.load(std::memory_order_relaxed)
+                                        ? ExecStatus::FAIL
+                                        : ExecStatus::PASS;
+        if (m_exec_status.exec_status == ExecStatus::PASS)
+        {
+            m_exec_status.ok_count++;
+        } else
+        {
+            m_exec_status.ng_count++;
+        }
+
+        token.busy = false;
+        m_pipeline_condition.notify_all();
+        return seq_results;
+    }
+
+    // the trigger only leaves the pipeline once its callbacks are done
+    void InvokeOnComplete(const std::vector<cppbase::Variant>& seq_results)
+    {
+        {
+            std::vector<std::future<void>> futures;
+            for (auto& callback : m_on_complete_callbacks)
+            {
+                futures.push_back(std::async(std::launch::async, callback, seq_results));
+            }
+        }
+        std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+        m_in_flight--;
+        m_pipeline_condition.notify_all();
+    }
+
+    // maps from a processor to links which have the key as the source processor
+    std::unordered_map<uuids::uuid, std::vector<Link>> m_proc_links;
+    std::thread m_exec_thread;
+    // updated with m_execute_mutex locked while no trigger is in flight, or by CompleteToken()
+    // under m_pipeline_mutex
+    SequenceExecutionStatus m_exec_status;
+    std::unordered_map<uuids::uuid, std::vector<std::pair<uint32_t, uint32_t>>> m_proc_inputs;
+
+    std::shared_ptr<Graph> m_graph;
+    std::atomic<bool> m_graph_valid{false};
+    mutable std::shared_ptr<const Topology> m_topology;
+    mutable std::mutex m_topology_mutex;
+    uint32_t m_concurrency{1};
+    bool m_caching{false};
+    std::atomic<bool> m_profiling{false};
+    Profiler m_profiler;
+    std::mutex m_execute_mutex;
+    Frame m_frame;
+    BatchFrame m_batch_frame;
+    // frames of the executions in subflows, see ExecuteSubflow()
+    std::vector<std::unique_ptr<Frame>> m_spare_frames;
+    uint32_t m_subflows{0};
+
+    // pipelined execution
+    uint32_t m_max_tokens{0};
+    std::unordered_map<uuids::uuid, StageType> m_stage_types;
+    std::vector<std::unique_ptr<Token>> m_tokens;
+    // per serial stage, the number of the token that may enter it next
+    std::vector<uint64_t> m_stage_next;
+    uint64_t m_next_token{0};
+    uint32_t m_in_flight{0};
+    std::mutex m_pipeline_mutex;
+    std::condition_variable m_pipeline_condition;
+
+    // triggers of the run thread
+    bool m_running{false};
+    std::deque<PendingTrigger> m_trigger_queue;
+    size_t m_trigger_capacity{16};
+    size_t m_batch_size{1};
+    TriggerPolicy m_trigger_policy{TriggerPolicy::DROP_OLDEST};
+    std::chrono::microseconds m_trigger_interval{0};
+    std::chrono::steady_clock::time_point m_next_tick;
+    std::atomic<uint64_t> m_dropped_triggers{0};
+    std::mutex m_trigger_mutex;
+    std::condition_variable m_trigger_condition;
+    LatencyHistogram m_trigger_latency;
+    mutable std::mutex m_latency_mutex;
 
     template<class Archive>
     void serialize(Archive& archive, const uint32_t)
@@ -0,0 +1,98 @@
+/**************************************************************************
+ * @file: SwitchProcessor.h
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ * All rights reserved.
+ *************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "Processor.h"
+
+namespace cppbase { namespace sequence {
+
+/**
+ * @brief Routes its input to one of its branches, the processors linked from output i form
+ *   branch i. A sequence only executes the branch taken for a trigger: processors whose links
+ *   in all come from untaken branches are pruned without being executed, processors linked
+ *   from the taken branch as well merge the branches and are executed.
+ *
+ *   The branch is selected by the selector if there is one, otherwise by the int input1.
+ *   Selecting a branch out of range, routing an empty input, or a switch that is skipped or
+ *   fails takes no branch.
+ */
+class SwitchProcessor : public Processor
+{
+public:
+    using Selector = std::function<int(const std::vector<cppbase::Variant>& inputs)>;
+
+    SwitchProcessor() = default;
+    /**
+     * @param type Type of the routed input and of the branches
+     * @param branch_count Number of branches
+     * @param selector Selects the branch from the inputs
+     */
+    SwitchProcessor(cppbase::Variant::Type type, uint32_t branch_count, Selector selector = {})
+      : m_type(type), m_branch_count(branch_count), m_selector(std::move(selector))
+    {}
+    ~SwitchProcessor() override = default;
+
+    bool Initialize(const cppbase::Variant& param = {}) override
+    {
+        Processor::Initialize(param);
+        AddInput("input0", m_type);
+        if (!m_selector)
+            AddInput("input1", cppbase::Variant::GetType<int>());
+        for (uint32_t i = 0; i < m_branch_count; ++i)
+            AddOutput("branch" + std::to_string(i), m_type);
+        return true;
+    }
+
+    uint32_t GetBranchCount() const { return m_branch_count; }
+
+    /**
+     * @brief Get the branch selected for the inputs, -1 for none
+     */
+    int SelectBranch(const std::vector<cppbase::Variant>& inputs) const
+    {
+        int branch = -1;
+        if (m_selector)
+            branch = m_selector(inputs);
+        else if (inputs.size() > 1 && inputs[1].IsValid())
+            branch = inputs[1].GetValue<int>();
+        if (branch < 0 || branch >= static_cast<int>(m_branch_count) || inputs.empty() ||
+            !inputs[0].IsValid())
+            return -1;
+        return branch;
+    }
+
+    ExecutionStatus Execute(const std::vector<cppbase::Variant>& inputs) override
+    {
+        if (!PreExecute(inputs))
+        {
+            return m_exec_status;
+        }
+        auto branch = SelectBranch(inputs);
+        {
+            // only the taken branch gets a result
+            std::lock_guard<std::mutex> lock(m_results_mutex);
+            m_results.assign(m_branch_count, {});
+            if (branch >= 0)
+                m_results[branch] = inputs[0];
+        }
+        PostExecute(m_results);
+
+        return m_exec_status;
+    }
+
+private:
+    cppbase::Variant::Type m_type{cppbase::Variant::GetType<float>()};
+    uint32_t m_branch_count{2};
+    Selector m_selector;
+};
+
+}}  // namespace cppbase::sequence
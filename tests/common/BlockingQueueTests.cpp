@@ -8,9 +8,117 @@
 #include <common/BlockingQueue.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
 using namespace cppbase;
 
 TEST(BlockingQueueTests, MultiThreadTest)
 {
     BlockingQueue<int32_t> queue;
 }
+
+TEST(BlockingQueueTests, MoveAndEmplaceTest)
+{
+    BlockingQueue<std::unique_ptr<int32_t>> queue;
+    auto value = std::make_unique<int32_t>(1);
+    EXPECT_TRUE(queue.Push(std::move(value)));
+    EXPECT_TRUE(queue.Emplace(new int32_t(2)));
+    EXPECT_EQ(queue.Size(), 2);
+
+    EXPECT_TRUE(queue.Pop(value));
+    EXPECT_EQ(*value, 1);
+    EXPECT_TRUE(queue.TryPop(value));
+    EXPECT_EQ(*value, 2);
+    EXPECT_FALSE(queue.TryPop(value, 10));
+    EXPECT_TRUE(queue.Empty());
+}
+
+TEST(BlockingQueueTests, BatchTest)
+{
+    BlockingQueue<int32_t> queue;
+    for (int32_t i = 0; i < 10; ++i)
+        queue.Push(i);
+
+    std::vector<int32_t> values;
+    EXPECT_EQ(queue.PopUpTo(4, std::back_inserter(values)), 4);
+    EXPECT_EQ(queue.PopAll(std::back_inserter(values)), 6);
+    EXPECT_EQ(values, std::vector<int32_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    EXPECT_TRUE(queue.Empty());
+}
+
+TEST(BlockingQueueTests, CloseTest)
+{
+    BlockingQueue<int32_t> queue;
+    queue.Push(1);
+
+    std::vector<std::thread> consumers;
+    std::atomic<int32_t> popped{0};
+    std::atomic<int32_t> returned{0};
+    for (int32_t i = 0; i < 3; ++i)
+    {
+        consumers.emplace_back([&] {
+            int32_t value = 0;
+            while (queue.Pop(value))
+                popped++;
+            returned++;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(returned, 0);
+
+    queue.Close();
+    for (auto& consumer : consumers)
+        consumer.join();
+    EXPECT_TRUE(queue.IsClosed());
+    EXPECT_EQ(popped, 1);
+    EXPECT_EQ(returned, 3);
+    EXPECT_FALSE(queue.Push(2));
+
+    std::vector<int32_t> values;
+    EXPECT_EQ(queue.PopAll(std::back_inserter(values)), 0);
+}
+
+TEST(BlockingQueueTests, BatchBenchmark)
+{
+    constexpr int32_t kItems = 200000;
+    auto run = [](auto pop) {
+        BlockingQueue<int64_t> queue;
+        auto start = std::chrono::steady_clock::now();
+        std::thread producer([&] {
+            for (int64_t i = 0; i < kItems; ++i)
+                queue.Push(i);
+            queue.Close();
+        });
+        int64_t sum = pop(queue);
+        producer.join();
+        EXPECT_EQ(sum, int64_t(kItems) * (kItems - 1) / 2);
+        return kItems / std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                            .count();
+    };
+
+    auto single = run([](BlockingQueue<int64_t>& queue) {
+        int64_t sum = 0;
+        int64_t value = 0;
+        while (queue.Pop(value))
+            sum += value;
+        return sum;
+    });
+    auto batched = run([](BlockingQueue<int64_t>& queue) {
+        int64_t sum = 0;
+        std::vector<int64_t> values;
+        while (queue.PopUpTo(256, std::back_inserter(values)))
+        {
+            for (auto value : values)
+                sum += value;
+            values.clear();
+        }
+        return sum;
+    });
+    std::cout << "Pop: " << single << " items/s, PopUpTo(256): " << batched << " items/s"
+              << std::endl;
+}
@@ -0,0 +1,61 @@
+/**************************************************************************
+ * @file:  CowPtrTests.cpp
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ **************************************************************************/
+
+#include <common/CowPtr.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace cppbase;
+
+TEST(CowPtrTests, CopyOnWrite)
+{
+    auto a = MakeCow<std::vector<int>>(1000, 1);
+    EXPECT_TRUE(a.IsUnique());
+    const int* data = a->data();
+
+    // copies share the value
+    auto b = a;
+    EXPECT_EQ(a.UseCount(), 2);
+    EXPECT_EQ(b->data(), data);
+    EXPECT_EQ(a, b);
+
+    // writing to a shared value copies it first
+    b.GetMutable()[0] = 2;
+    EXPECT_NE(b->data(), data);
+    EXPECT_EQ(a.Get()[0], 1);
+    EXPECT_EQ(b.Get()[0], 2);
+    EXPECT_NE(a, b);
+
+    // a unique value is written in place
+    EXPECT_TRUE(a.IsUnique());
+    a.GetMutable()[0] = 3;
+    EXPECT_EQ(a->data(), data);
+
+    CowPtr<std::vector<int>> empty;
+    EXPECT_FALSE(empty);
+}
+
+TEST(CowPtrTests, ConcurrentWriters)
+{
+    auto shared = MakeCow<std::vector<int>>(100000, 0);
+    std::vector<std::thread> threads;
+    for (int i = 1; i <= 4; ++i)
+    {
+        threads.emplace_back([copy = shared, i]() mutable {
+            for (auto& v : copy.GetMutable())
+                v = i;
+            for (auto v : copy.Get())
+                ASSERT_EQ(v, i);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (auto v : shared.Get())
+        ASSERT_EQ(v, 0);
+}
@@ -0,0 +1,118 @@
+/**************************************************************************
+ * @file:  CpuTopologyTests.cpp
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ **************************************************************************/
+
+#include <common/CpuTopology.h>
+#include <common/NumaThreadPool.h>
+#include <gtest/gtest.h>
+
+using namespace cppbase;
+
+namespace {
+
+void WriteFile(const fs::path& path, const std::string& content)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream file(path);
+    file << content << std::endl;
+}
+
+// Dual socket box, 2 cores per socket with 2 SMT siblings each. Like on most Intel machines,
+// the siblings are numbered after all the physical cores:
+//   node0/package0: core0 = {0, 4}, core1 = {1, 5}
+//   node1/package1: core0 = {2, 6}, core1 = {3, 7}
+CpuTopology FakeDualSocketTopology()
+{
+    auto root = fs::temp_directory_path() / "cppbase_cpu_topology_tests";
+    fs::remove_all(root);
+    WriteFile(root / "cpu" / "online", "0-7");
+    for (uint32_t id = 0; id < 8; ++id)
+    {
+        auto dir = root / "cpu" / ("cpu" + std::to_string(id)) / "topology";
+        WriteFile(dir / "physical_package_id", std::to_string((id % 4) / 2));
+        WriteFile(dir / "core_id", std::to_string(id % 2));
+    }
+    WriteFile(root / "node" / "node0" / "cpulist", "0-1,4-5");
+    WriteFile(root / "node" / "node1" / "cpulist", "2-3,6-7");
+    WriteFile(root / "node" / "possible", "0-1");
+    auto topology = CpuTopology::Detect(root.string());
+    fs::remove_all(root);
+    return topology;
+}
+
+}  // namespace
+
+TEST(CpuTopologyTests, ParseCpuList)
+{
+    EXPECT_EQ(CpuTopology::ParseCpuList("0-3,8,10-11\n"),
+              (std::vector<uint32_t>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_TRUE(CpuTopology::ParseCpuList("").empty());
+}
+
+TEST(CpuTopologyTests, DetectTest)
+{
+    auto topology = FakeDualSocketTopology();
+    ASSERT_EQ(topology.GetCpus().size(), 8u);
+    EXPECT_EQ(topology.GetPackageCount(), 2u);
+    EXPECT_EQ(topology.GetPhysicalCoreCount(), 4u);
+    EXPECT_EQ(topology.GetNodes(), (std::vector<int32_t>{0, 1}));
+    EXPECT_EQ(topology.GetCpu(6)->node, 1);
+    EXPECT_EQ(topology.GetCpu(6)->package, 1);
+    EXPECT_EQ(topology.GetCpu(6)->core, 0);
+
+    // the machine we run on always has at least one CPU
+    const auto& system = CpuTopology::Instance();
+    EXPECT_FALSE(system.GetCpus().empty());
+    EXPECT_FALSE(system.GetNodes().empty());
+}
+
+TEST(CpuTopologyTests, PlacementTest)
+{
+    using Sets = std::vector<std::vector<uint32_t>>;
+    auto topology = FakeDualSocketTopology();
+    ThreadPlacement placement;
+
+    EXPECT_EQ(topology.Place(placement, 2), (Sets{{}, {}}));
+
+    placement.policy = PlacementPolicy::EXPLICIT;
+    placement.cpus = {3, 5};
+    EXPECT_EQ(topology.Place(placement, 3), (Sets{{3}, {5}, {3}}));
+    placement.cpus.clear();
+
+    placement.policy = PlacementPolicy::PHYSICAL_CORES;
+    EXPECT_EQ(topology.Place(placement, 4), (Sets{{0, 4}, {1, 5}, {2, 6}, {3, 7}}));
+
+    placement.policy = PlacementPolicy::COMPACT;
+    EXPECT_EQ(topology.Place(placement, 4), (Sets{{0}, {4}, {1}, {5}}));
+
+    placement.policy = PlacementPolicy::SCATTER;
+    EXPECT_EQ(topology.Place(placement, 8), (Sets{{0}, {2}, {1}, {3}, {4}, {6}, {5}, {7}}));
+
+    // reserve any CPUs, not just the lowest ones
+    placement.reserved_cpus = {2, 6};
+    EXPECT_EQ(topology.Place(placement, 4), (Sets{{0}, {3}, {1}, {4}}));
+    placement.reserved_cpus.clear();
+
+    placement.policy = PlacementPolicy::COMPACT;
+    placement.numa_node = 1;
+    EXPECT_EQ(topology.Place(placement, 4), (Sets{{2}, {6}, {3}, {7}}));
+}
+
+TEST(CpuTopologyTests, ThreadPoolPlacementTest)
+{
+    ThreadPoolOptions options;
+    options.placement.policy = PlacementPolicy::PHYSICAL_CORES;
+    ThreadPool pool(2, ThreadPriority::NORMAL, 0, options);
+    ASSERT_EQ(pool.GetWorkerCpus().size(), 2u);
+    EXPECT_FALSE(pool.GetWorkerCpus()[0].empty());
+    EXPECT_EQ(pool.Enqueue([] { return 42; }).get(), 42);
+
+    NumaThreadPool numa_pool(2, ThreadPriority::NORMAL);
+    EXPECT_EQ(numa_pool.GetNodeCount(), CpuTopology::Instance().GetNodes().size());
+    for (uint32_t node = 0; node < numa_pool.GetNodeCount(); ++node)
+        EXPECT_EQ(numa_pool.Enqueue(node, [node] { return node; }).get(), node);
+    EXPECT_EQ(numa_pool.Enqueue([] { return 7; }).get(), 7);
+}
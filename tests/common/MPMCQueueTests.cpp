@@ -0,0 +1,131 @@
+/**************************************************************************
+ * @file:  MPMCQueueTests.cpp
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ **************************************************************************/
+
+#include <common/BlockingQueue.h>
+#include <common/MPMCQueue.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace cppbase;
+
+TEST(MPMCQueueTests, SimpleTest)
+{
+    MPMCQueue<int32_t> queue(5);
+    EXPECT_EQ(queue.Capacity(), 8);
+    EXPECT_TRUE(queue.Empty());
+    for (int32_t i = 0; i < 8; ++i)
+        EXPECT_TRUE(queue.TryPush(i));
+    EXPECT_FALSE(queue.TryPush(8));
+    EXPECT_EQ(queue.Size(), 8);
+
+    int32_t value = -1;
+    for (int32_t i = 0; i < 8; ++i)
+    {
+        EXPECT_TRUE(queue.TryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.TryPop(value));
+    EXPECT_FALSE(queue.TryPop(value, 10));
+    EXPECT_TRUE(queue.Empty());
+}
+
+TEST(MPMCQueueTests, MoveOnlyTest)
+{
+    MPMCQueue<std::unique_ptr<int32_t>> queue(4);
+    queue.Push(std::make_unique<int32_t>(1));
+    auto value = std::make_unique<int32_t>(2);
+    EXPECT_TRUE(queue.TryPush(std::move(value)));
+    EXPECT_FALSE(value);
+
+    std::unique_ptr<int32_t> result;
+    queue.Pop(result);
+    EXPECT_EQ(*result, 1);
+    queue.Pop(result);
+    EXPECT_EQ(*result, 2);
+
+    // values left in the queue are destroyed with it
+    queue.Push(std::make_unique<int32_t>(3));
+}
+
+TEST(MPMCQueueTests, BackpressureTest)
+{
+    MPMCQueue<int32_t> rejecting(2, BackpressurePolicy::REJECT);
+    EXPECT_TRUE(rejecting.Push(1));
+    EXPECT_TRUE(rejecting.Push(2));
+    EXPECT_FALSE(rejecting.Push(3));
+    EXPECT_EQ(rejecting.GetRejectedCount(), 1);
+
+    MPMCQueue<int32_t> blocking(2, BackpressurePolicy::BLOCK);
+    blocking.Push(1);
+    blocking.Push(2);
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] {
+        blocking.Push(3);
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(pushed);
+    int32_t value = 0;
+    blocking.Pop(value);
+    producer.join();
+    EXPECT_TRUE(pushed);
+    blocking.Pop(value);
+    blocking.Pop(value);
+    EXPECT_EQ(value, 3);
+}
+
+TEST(MPMCQueueTests, MultiThreadTest)
+{
+    constexpr int32_t kProducers = 4;
+    constexpr int32_t kConsumers = 4;
+    constexpr int64_t kItems = 100000;
+
+    // compare with BlockingQueue on the same workload, the bounded queue also blocks producers
+    // that get too far ahead
+    auto run = [](auto& queue, auto push) {
+        std::atomic<int64_t> sum{0};
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int32_t p = 0; p < kProducers; ++p)
+        {
+            threads.emplace_back([&, push] {
+                for (int64_t i = 1; i <= kItems; ++i)
+                    push(queue, i);
+            });
+        }
+        for (int32_t c = 0; c < kConsumers; ++c)
+        {
+            threads.emplace_back([&] {
+                int64_t local = 0;
+                int64_t value = 0;
+                for (int64_t i = 0; i < kItems; ++i)
+                {
+                    queue.Pop(value);
+                    local += value;
+                }
+                sum += local;
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+        EXPECT_EQ(sum, kProducers * kItems * (kItems + 1) / 2);
+        return kProducers * kItems / elapsed.count();
+    };
+
+    MPMCQueue<int64_t> bounded(1024);
+    auto bounded_rate = run(bounded, [](auto& queue, int64_t i) { queue.Push(i); });
+    BlockingQueue<int64_t> unbounded;
+    auto unbounded_rate = run(unbounded, [](auto& queue, int64_t i) { queue.Push(i); });
+    std::cout << "MPMCQueue: " << bounded_rate << " items/s, BlockingQueue: " << unbounded_rate
+              << " items/s" << std::endl;
+    EXPECT_TRUE(bounded.Empty());
+}
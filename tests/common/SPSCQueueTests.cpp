@@ -0,0 +1,152 @@
+/**************************************************************************
+ * @file:  SPSCQueueTests.cpp
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ **************************************************************************/
+
+#include <common/BlockingQueue.h>
+#include <common/SPSCQueue.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace cppbase;
+
+TEST(SPSCQueueTests, SimpleTest)
+{
+    SPSCQueue<std::unique_ptr<int32_t>> queue(3);
+    EXPECT_EQ(queue.Capacity(), 4);
+    for (int32_t i = 0; i < 4; ++i)
+        EXPECT_TRUE(queue.TryPush(std::make_unique<int32_t>(i)));
+    EXPECT_FALSE(queue.TryPush(std::make_unique<int32_t>(4)));
+    EXPECT_EQ(queue.Size(), 4);
+
+    std::unique_ptr<int32_t> value;
+    for (int32_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.TryPop(value));
+        EXPECT_EQ(*value, i);
+    }
+    EXPECT_FALSE(queue.TryPop(value));
+    EXPECT_FALSE(queue.TryPop(value, 10));
+    EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SPSCQueueTests, BatchTest)
+{
+    SPSCQueue<int32_t> queue(8);
+    std::vector<int32_t> input(20);
+    std::iota(input.begin(), input.end(), 0);
+    std::vector<int32_t> output(20);
+
+    // batches wrap around the end of the buffer
+    EXPECT_EQ(queue.PushN(input.begin(), 5), 5);
+    EXPECT_EQ(queue.PopN(output.begin(), 5), 5);
+    EXPECT_EQ(queue.PushN(input.begin() + 5, 15), 8);
+    EXPECT_EQ(queue.PopN(output.begin() + 5, 20), 8);
+    EXPECT_EQ(queue.PushN(input.begin() + 13, 7), 7);
+    EXPECT_EQ(queue.PopN(output.begin() + 13, 7), 7);
+    EXPECT_EQ(input, output);
+}
+
+TEST(SPSCQueueTests, BlockingTest)
+{
+    SPSCQueue<int32_t> queue(16);
+    int32_t value = 0;
+    std::thread consumer([&] { queue.Pop(value); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.Push(42);
+    consumer.join();
+    EXPECT_EQ(value, 42);
+
+    std::thread producer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.Push(43);
+    });
+    EXPECT_TRUE(queue.TryPop(value, 1000));
+    EXPECT_EQ(value, 43);
+    producer.join();
+}
+
+namespace {
+
+template <size_t Size>
+struct Payload
+{
+    std::array<char, Size> data{};
+    int64_t sequence{0};
+};
+
+template <size_t Size>
+void CompareWithBlockingQueue(int64_t items)
+{
+    using Item = Payload<Size>;
+    auto run = [items](auto push, auto pop) {
+        auto start = std::chrono::steady_clock::now();
+        std::thread producer([&] {
+            Item item;
+            for (int64_t i = 0; i < items; ++i)
+            {
+                item.sequence = i;
+                push(item);
+            }
+        });
+        int64_t expected = 0;
+        Item item;
+        for (int64_t i = 0; i < items; ++i)
+        {
+            pop(item);
+            expected += item.sequence == i;
+        }
+        producer.join();
+        EXPECT_EQ(expected, items);
+        return items / std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                           .count();
+    };
+
+    SPSCQueue<Item> spsc(1024);
+    auto spsc_rate = run([&](const Item& item) { spsc.Push(item); },
+                         [&](Item& item) { spsc.Pop(item); });
+
+    // the consumer drains up to 64 items per PopN
+    SPSCQueue<Item> batched(1024);
+    std::vector<Item> batch(64);
+    size_t consumed = 0;
+    size_t available = 0;
+    auto batched_rate = run(
+        [&](const Item& item) {
+            while (batched.PushN(&item, 1) == 0)
+                std::this_thread::yield();
+        },
+        [&](Item& item) {
+            if (consumed == available)
+            {
+                consumed = 0;
+                available = batched.PopN(batch.begin(), batch.size(), 1000);
+            }
+            item = batch[consumed++];
+        });
+
+    BlockingQueue<Item> blocking;
+    auto blocking_rate = run([&](const Item& item) { blocking.Push(item); },
+                             [&](Item& item) { blocking.Pop(item); });
+
+    std::cout << "Payload " << sizeof(Item) << " bytes: SPSCQueue " << spsc_rate
+              << " items/s, SPSCQueue PopN " << batched_rate << " items/s, BlockingQueue "
+              << blocking_rate << " items/s" << std::endl;
+}
+
+}  // namespace
+
+TEST(SPSCQueueTests, Benchmark)
+{
+    CompareWithBlockingQueue<8>(200000);
+    CompareWithBlockingQueue<64>(200000);
+    CompareWithBlockingQueue<1024>(50000);
+}
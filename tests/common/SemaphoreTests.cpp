@@ -8,7 +8,12 @@
 #include <common/Semaphore.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 TEST(SemaphoreTests, ProducerAndConsumer)
 {
@@ -33,3 +38,123 @@ TEST(SemaphoreTests, ProducerAndConsumer)
     producer.join();
     consumer.join();
 }
+
+TEST(SemaphoreTests, TimeoutTest)
+{
+    using namespace std::chrono;
+    cppbase::Semaphore sem;
+    auto start = steady_clock::now();
+    EXPECT_FALSE(sem.TryWait(milliseconds(20)));
+    EXPECT_GE(steady_clock::now() - start, milliseconds(20));
+    EXPECT_FALSE(sem.TryWaitUntil(steady_clock::now() - milliseconds(1)));
+
+    sem.Notify();
+    EXPECT_TRUE(sem.TryWait(microseconds(0)));
+    EXPECT_EQ(sem.GetCount(), 0);
+
+    std::thread notifier([&] {
+        std::this_thread::sleep_for(milliseconds(10));
+        sem.Notify();
+    });
+    EXPECT_TRUE(sem.TryWaitUntil(steady_clock::now() + seconds(5)));
+    notifier.join();
+}
+
+TEST(SemaphoreTests, NotifyManyTest)
+{
+    cppbase::Semaphore sem;
+    std::atomic<int32_t> acquired{0};
+    std::vector<std::thread> waiters;
+    for (int32_t i = 0; i < 4; ++i)
+    {
+        waiters.emplace_back([&] {
+            sem.Wait();
+            acquired++;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(acquired, 0);
+
+    sem.Notify(3);
+    while (acquired < 3)
+        std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(acquired, 3);
+    sem.Notify(1);
+    for (auto& waiter : waiters)
+        waiter.join();
+    EXPECT_EQ(acquired, 4);
+    EXPECT_EQ(sem.GetCount(), 0);
+}
+
+namespace {
+
+// the previous mutex and condition variable implementation, as a baseline
+class MutexSemaphore
+{
+public:
+    void Notify()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_count++;
+        }
+        m_cv.notify_one();
+    }
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_count == 0)
+            m_cv.wait(lock);
+        m_count--;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    int32_t m_count{0};
+};
+
+template <typename Sem>
+std::pair<double, double> MeasureSemaphore()
+{
+    using namespace std::chrono;
+    constexpr int32_t kUncontended = 1000000;
+    constexpr int32_t kHandoffs = 200000;
+
+    // uncontended: notify and wait on the same thread, e.g. a frame that is already there
+    Sem sem;
+    auto start = steady_clock::now();
+    for (int32_t i = 0; i < kUncontended; ++i)
+    {
+        sem.Notify();
+        sem.Wait();
+    }
+    double uncontended_ns = duration<double, std::nano>(steady_clock::now() - start).count() /
+                            kUncontended;
+
+    // producer/consumer hand-off of every item
+    Sem items;
+    start = steady_clock::now();
+    std::thread consumer([&] {
+        for (int32_t i = 0; i < kHandoffs; ++i)
+            items.Wait();
+    });
+    for (int32_t i = 0; i < kHandoffs; ++i)
+        items.Notify();
+    consumer.join();
+    double handoffs_per_sec = kHandoffs / duration<double>(steady_clock::now() - start).count();
+    return {uncontended_ns, handoffs_per_sec};
+}
+
+}  // namespace
+
+TEST(SemaphoreTests, Benchmark)
+{
+    auto futex = MeasureSemaphore<cppbase::Semaphore>();
+    auto mutex = MeasureSemaphore<MutexSemaphore>();
+    std::cout << "Semaphore: notify+wait " << futex.first << " ns, " << futex.second
+              << " hand-offs/s" << std::endl;
+    std::cout << "Mutex semaphore: notify+wait " << mutex.first << " ns, " << mutex.second
+              << " hand-offs/s" << std::endl;
+}
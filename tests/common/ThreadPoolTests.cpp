@@ -8,8 +8,59 @@
 #include <common/ThreadPool.h>
 #include <gtest/gtest.h>
 
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
 using namespace cppbase;
 
+// Count global heap allocations while enabled, so the tests can verify allocation-free
+// submission. The replacements cover every form the standard library may call.
+static std::atomic<bool> g_count_allocations{false};
+static std::atomic<uint64_t> g_allocations{0};
+
+static void* CountedAlloc(size_t size, size_t alignment = 0)
+{
+    if (g_count_allocations.load(std::memory_order_relaxed))
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    size = size ? size : 1;
+    // aligned_alloc needs a multiple of the alignment
+    void* p = alignment ? std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1))
+                        : std::malloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void* operator new(size_t size, std::align_val_t al) { return CountedAlloc(size, size_t(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return CountedAlloc(size, size_t(al)); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+/**
+ * @brief Count the allocations of all threads during its lifetime
+ */
+class AllocationCounter
+{
+public:
+    AllocationCounter() : m_before(g_allocations.load()) { g_count_allocations = true; }
+    ~AllocationCounter() { g_count_allocations = false; }
+
+    uint64_t GetCount() const { return g_allocations.load() - m_before; }
+
+private:
+    uint64_t m_before;
+};
+
 TEST(ThreadPoolTests, SimpleTest)
 {
     ThreadPool pool(4, ThreadPriority::NORMAL);
@@ -60,3 +111,376 @@ TEST(ThreadPoolTests, PriorityAndCpuTest)
         ret++;
     }
 }
+
+TEST(ThreadPoolTests, WorkStealingTest)
+{
+    ThreadPoolOptions options;
+    options.scheduling = SchedulingPolicy::WORK_STEALING;
+    ThreadPool pool(4, ThreadPriority::NORMAL, 0, options);
+    EXPECT_EQ(pool.GetSchedulingPolicy(), SchedulingPolicy::WORK_STEALING);
+
+    // tasks spawned from inside the pool go to the spawning worker's deque and get stolen
+    std::atomic<int32_t> count{0};
+    std::function<void(int32_t)> spawn = [&](int32_t depth) {
+        count++;
+        if (depth > 0)
+        {
+            pool.Enqueue(spawn, depth - 1);
+            pool.Enqueue(spawn, depth - 1);
+        }
+    };
+    pool.Enqueue(spawn, 10);
+    while (count < (1 << 11) - 1)
+        std::this_thread::yield();
+    EXPECT_EQ(count, (1 << 11) - 1);
+
+    std::vector<std::future<int32_t>> results;
+    for (int32_t i = 0; i < 100; ++i)
+        results.emplace_back(pool.Enqueue([i] { return i * i; }));
+    for (int32_t i = 0; i < 100; ++i)
+        EXPECT_EQ(results[i].get(), i * i);
+}
+
+TEST(ThreadPoolTests, ContentionBenchmark)
+{
+    constexpr int32_t kTasks = 200000;
+    const uint32_t threads = std::max(16u, std::thread::hardware_concurrency());
+
+    auto run = [&](SchedulingPolicy policy, bool nested) {
+        ThreadPoolOptions options;
+        options.scheduling = policy;
+        ThreadPool pool(threads, ThreadPriority::NORMAL, 0, options);
+        std::atomic<int32_t> done{0};
+        auto start = std::chrono::steady_clock::now();
+        if (nested)
+        {
+            // every external task fans out into 16 short tasks from inside the pool
+            for (int32_t i = 0; i < kTasks / 16; ++i)
+            {
+                pool.Enqueue([&] {
+                    for (int32_t j = 0; j < 16; ++j)
+                        pool.Enqueue([&] { done++; });
+                });
+            }
+        } else
+        {
+            for (int32_t i = 0; i < kTasks; ++i)
+                pool.Enqueue([&] { done++; });
+        }
+        while (done < kTasks)
+            std::this_thread::yield();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        return static_cast<double>(kTasks) / elapsed.count() * 1e6;
+    };
+
+    for (bool nested : {false, true})
+    {
+        auto single = run(SchedulingPolicy::SINGLE_QUEUE, nested);
+        auto stealing = run(SchedulingPolicy::WORK_STEALING, nested);
+        std::cout << "ThreadPoolTests::ContentionBenchmark " << threads << " threads, "
+                  << (nested ? "nested" : "external") << " submission: single queue " << single
+                  << " tasks/s, work stealing " << stealing << " tasks/s" << std::endl;
+    }
+}
+
+TEST(ThreadPoolTests, TaskTest)
+{
+    int32_t value = 0;
+    auto increment = [&value] { value++; };
+    EXPECT_TRUE(Task::IsInline<decltype(increment)>());
+    Task small(increment);
+    Task moved(std::move(small));
+    EXPECT_FALSE(small);
+    moved();
+    EXPECT_EQ(value, 1);
+
+    // large captures fall back to the heap but behave the same
+    std::array<char, 256> large{};
+    Task big([large, &value] { value += static_cast<int32_t>(large.size()); });
+    big();
+    EXPECT_EQ(value, 257);
+
+    // move-only captures are supported
+    auto ptr = std::make_unique<int32_t>(42);
+    Task move_only([p = std::move(ptr), &value] { value = *p; });
+    move_only();
+    EXPECT_EQ(value, 42);
+
+    TaskQueue queue;
+    for (int32_t i = 0; i < 100; ++i)
+        queue.Push([&value, i] { value = i; });
+    EXPECT_EQ(queue.Size(), 100);
+    queue.PopBack()();
+    EXPECT_EQ(value, 99);
+    queue.PopFront()();
+    EXPECT_EQ(value, 0);
+    EXPECT_EQ(queue.Size(), 98);
+}
+
+TEST(ThreadPoolTests, AllocationFreeSubmission)
+{
+    constexpr int32_t kTasks = 10000;
+
+    for (auto policy : {SchedulingPolicy::SINGLE_QUEUE, SchedulingPolicy::WORK_STEALING})
+    {
+        ThreadPoolOptions options;
+        options.scheduling = policy;
+        ThreadPool pool(2, ThreadPriority::NORMAL, 0, options);
+        std::atomic<int32_t> done{0};
+        std::vector<std::future<int32_t>> futures;
+        futures.reserve(kTasks);
+
+        auto submit = [&](int32_t count) {
+            done = 0;
+            futures.clear();
+            for (int32_t i = 0; i < count; ++i)
+            {
+                pool.Post([&done] { done++; });
+                futures.push_back(pool.Enqueue([i] { return i; }));
+            }
+            while (done < count)
+                std::this_thread::yield();
+            for (int32_t i = 0; i < count; ++i)
+                EXPECT_EQ(futures[i].get(), i);
+        };
+
+        // Warm up with the workers blocked, so the queues and the shared state pool grow past
+        // what the measured run needs. Workers may release a few shared states only after
+        // the futures are ready, hence the measured run submits fewer tasks.
+        std::atomic<bool> blocked{true};
+        for (int32_t i = 0; i < 2; ++i)
+            pool.Post([&blocked] {
+                while (blocked)
+                    std::this_thread::yield();
+            });
+        std::thread release([&blocked] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            blocked = false;
+        });
+        submit(kTasks);
+        release.join();
+
+        AllocationCounter counter;
+        submit(kTasks / 2);
+        EXPECT_EQ(counter.GetCount(), 0u);
+    }
+}
+
+TEST(ThreadPoolTests, MetricsTest)
+{
+    for (auto policy : {SchedulingPolicy::SINGLE_QUEUE, SchedulingPolicy::WORK_STEALING})
+    {
+        ThreadPoolOptions options;
+        options.scheduling = policy;
+        ThreadPool pool(2, ThreadPriority::NORMAL, 0, options);
+        EXPECT_FALSE(pool.IsMetricsEnabled());
+
+        // nothing is collected while metrics are disabled
+        pool.Enqueue([] {}).wait();
+        EXPECT_EQ(pool.GetMetrics().tasks, 0u);
+
+        pool.EnableMetrics(true);
+        pool.SetMetricsLogInterval(std::chrono::milliseconds(50));
+        std::vector<std::future<void>> futures;
+        for (int32_t i = 0; i < 20; ++i)
+        {
+            futures.push_back(pool.Enqueue(
+                [] { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }));
+        }
+        for (auto& future : futures)
+            future.wait();
+        // the last task's counters are updated right after its future becomes ready
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        auto metrics = pool.GetMetrics();
+        EXPECT_EQ(metrics.tasks, 20u);
+        EXPECT_EQ(metrics.workers.size(), 2u);
+        EXPECT_EQ(metrics.queue_depth, 0u);
+        EXPECT_GE(metrics.queue_depth_high_water, 10u);
+        EXPECT_GE(metrics.avg_run_us, 4000);
+        EXPECT_GE(metrics.max_run_us, metrics.avg_run_us);
+        // 20 tasks of 5 ms on 2 workers, the later ones wait for the earlier ones
+        EXPECT_GE(metrics.max_wait_us, 20000);
+        EXPECT_GT(metrics.tasks_per_sec, 0);
+        for (const auto& worker : metrics.workers)
+        {
+            EXPECT_GT(worker.busy_ratio, 0);
+            EXPECT_LE(worker.busy_ratio, 1);
+        }
+        pool.SetMetricsLogInterval(std::chrono::milliseconds(0));
+
+        pool.EnableMetrics(false);
+        pool.EnableMetrics(true);
+        EXPECT_EQ(pool.GetMetrics().tasks, 0u);
+    }
+}
+
+TEST(ThreadPoolTests, TaskPriorityTest)
+{
+    // Block the single worker, queue tasks of every priority and record the execution order
+    auto run = [](const ThreadPoolOptions& options, int32_t tasks_per_priority) {
+        ThreadPool pool(1, ThreadPriority::NORMAL, 0, options);
+        std::atomic<bool> blocked{true};
+        pool.Post([&blocked] {
+            while (blocked)
+                std::this_thread::yield();
+        });
+        std::mutex mutex;
+        std::vector<TaskPriority> order;
+        std::vector<std::future<void>> futures;
+        for (int32_t i = 0; i < tasks_per_priority; ++i)
+        {
+            for (auto priority : {TaskPriority::LOW, TaskPriority::NORMAL, TaskPriority::HIGH,
+                                  TaskPriority::CRITICAL})
+            {
+                futures.push_back(pool.Enqueue(priority, [&, priority] {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    order.push_back(priority);
+                }));
+            }
+        }
+        blocked = false;
+        for (auto& future : futures)
+            future.wait();
+        return order;
+    };
+
+    ThreadPoolOptions options;
+    options.starvation_threshold = std::chrono::microseconds(0);
+    auto order = run(options, 10);
+    ASSERT_EQ(order.size(), 40u);
+    EXPECT_TRUE(std::is_sorted(order.rbegin(), order.rend()));
+
+    // weighted draining interleaves the priorities 8:4:2:1
+    options.drain_policy = DrainPolicy::WEIGHTED;
+    order = run(options, 10);
+    ASSERT_EQ(order.size(), 40u);
+    auto first = std::vector<TaskPriority>(order.begin(), order.begin() + 15);
+    EXPECT_EQ(std::count(first.begin(), first.end(), TaskPriority::CRITICAL), 8);
+    EXPECT_EQ(std::count(first.begin(), first.end(), TaskPriority::HIGH), 4);
+    EXPECT_EQ(std::count(first.begin(), first.end(), TaskPriority::NORMAL), 2);
+    EXPECT_EQ(std::count(first.begin(), first.end(), TaskPriority::LOW), 1);
+
+    // the shared queues of the work-stealing mode honor priorities as well
+    options.drain_policy = DrainPolicy::STRICT;
+    options.scheduling = SchedulingPolicy::WORK_STEALING;
+    order = run(options, 10);
+    ASSERT_EQ(order.size(), 40u);
+    EXPECT_TRUE(std::is_sorted(order.rbegin(), order.rend()));
+}
+
+TEST(ThreadPoolTests, StarvationProtectionTest)
+{
+    ThreadPoolOptions options;
+    options.starvation_threshold = std::chrono::milliseconds(10);
+    ThreadPool pool(1, ThreadPriority::NORMAL, 0, options);
+
+    std::atomic<bool> blocked{true};
+    pool.Post([&blocked] {
+        while (blocked)
+            std::this_thread::yield();
+    });
+    std::atomic<int32_t> high_done{0};
+    int32_t high_done_before_low = -1;
+    auto low = pool.Enqueue(TaskPriority::LOW, [&] { high_done_before_low = high_done; });
+    std::vector<std::future<void>> futures;
+    for (int32_t i = 0; i < 50; ++i)
+    {
+        futures.push_back(pool.Enqueue(TaskPriority::HIGH, [&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            high_done++;
+        }));
+    }
+    blocked = false;
+    low.wait();
+    for (auto& future : futures)
+        future.wait();
+    // the LOW task must not wait for the whole HIGH backlog
+    EXPECT_GE(high_done_before_low, 0);
+    EXPECT_LT(high_done_before_low, 50);
+}
+
+#ifdef __linux__
+TEST(ThreadPoolTests, OsThreadPriorityTest)
+{
+    // Without CAP_SYS_NICE the real-time priorities fall back gracefully
+    std::thread thread([] {
+        auto rv = SetThreadPriority(ThreadPriority::HIGH);
+        auto pri = GetThreadPriority(static_cast<int64_t>(pthread_self()));
+        if (rv == 0)
+            EXPECT_EQ(pri, static_cast<int32_t>(ThreadPriority::HIGH));
+        else
+            EXPECT_EQ(pri, 0);
+        EXPECT_EQ(SetThreadPriority(ThreadPriority::NORMAL), 0);
+    });
+    thread.join();
+}
+#endif
+
+TEST(ThreadPoolTests, ElasticTest)
+{
+    using namespace std::chrono;
+    constexpr int32_t kTasks = 40;
+
+    // post a burst of blocking tasks and return the 99th percentile queue wait in us
+    auto run_burst = [](ThreadPool& pool, std::atomic<uint32_t>& peak_threads) {
+        std::vector<int64_t> waits(kTasks);
+        std::vector<std::future<void>> futures;
+        for (int32_t i = 0; i < kTasks; ++i)
+        {
+            auto posted = steady_clock::now();
+            futures.push_back(pool.Enqueue([&waits, &pool, &peak_threads, posted, i] {
+                waits[i] = duration_cast<microseconds>(steady_clock::now() - posted).count();
+                auto threads = pool.GetThreadCount();
+                auto peak = peak_threads.load();
+                while (peak < threads && !peak_threads.compare_exchange_weak(peak, threads))
+                {
+                }
+                std::this_thread::sleep_for(milliseconds(5));
+            }));
+        }
+        for (auto& future : futures)
+            future.wait();
+        std::sort(waits.begin(), waits.end());
+        return waits[kTasks * 99 / 100];
+    };
+
+    for (auto scheduling : {SchedulingPolicy::SINGLE_QUEUE, SchedulingPolicy::WORK_STEALING})
+    {
+        ThreadPoolOptions options;
+        options.scheduling = scheduling;
+        std::atomic<uint32_t> fixed_peak{0};
+        int64_t fixed_p99 = 0;
+        {
+            ThreadPool fixed(1, ThreadPriority::NORMAL, 0, options);
+            fixed_p99 = run_burst(fixed, fixed_peak);
+        }
+
+        options.elastic.enabled = true;
+        options.elastic.min_threads = 1;
+        options.elastic.max_threads = 4;
+        options.elastic.scale_up_wait = milliseconds(2);
+        options.elastic.idle_timeout = milliseconds(50);
+        ThreadPool pool(1, ThreadPriority::NORMAL, 0, options);
+        EXPECT_EQ(pool.GetThreadCount(), 1);
+        EXPECT_EQ(pool.GetWorkerCpus().size(), 4);
+
+        for (int32_t burst = 0; burst < 2; ++burst)
+        {
+            std::atomic<uint32_t> peak{0};
+            auto p99 = run_burst(pool, peak);
+            std::cout << "Burst " << burst << ": peak threads " << peak << ", p99 wait " << p99
+                      << " us (fixed pool " << fixed_p99 << " us)" << std::endl;
+            EXPECT_GT(peak, 1);
+            EXPECT_LE(peak, 4);
+            EXPECT_LT(p99, fixed_p99 / 2);
+
+            // idle workers retire down to min_threads
+            auto deadline = steady_clock::now() + seconds(2);
+            while (pool.GetThreadCount() > 1 && steady_clock::now() < deadline)
+                std::this_thread::sleep_for(milliseconds(10));
+            EXPECT_EQ(pool.GetThreadCount(), 1);
+        }
+    }
+}
@@ -9,7 +9,12 @@
 #include <common/ForkJoinPool.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 static void foo(const uint64_t begin, uint64_t *result)
 {
@@ -44,3 +49,184 @@ TEST(ForkJoinPoolTests, ThreadPoolTest)
     batch(pool, {3, 5});
     batch(pool, {7, 9});
 }
+
+static uint64_t fib_serial(uint64_t n)
+{
+    return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+static uint64_t fib(asio::fork_join_pool &pool, uint64_t n)
+{
+    if (n < 20)
+        return fib_serial(n);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    {
+        asio::fork_executor fork(pool);
+        asio::join_guard join(fork);
+        asio::execution::execute(fork, [&pool, &a, n]() { a = fib(pool, n - 1); });
+        b = fib(pool, n - 2);
+    }
+    return a + b;
+}
+
+template <typename It>
+static void merge_sort(asio::fork_join_pool *pool, It begin, It end, It buffer)
+{
+    auto size = end - begin;
+    if (size < 4096)
+    {
+        std::sort(begin, end);
+        return;
+    }
+    auto middle = begin + size / 2;
+    auto buffer_middle = buffer + size / 2;
+    if (pool)
+    {
+        asio::fork_executor fork(*pool);
+        asio::join_guard join(fork);
+        asio::execution::execute(fork, [=]() { merge_sort(pool, begin, middle, buffer); });
+        merge_sort(pool, middle, end, buffer_middle);
+    }
+    else
+    {
+        merge_sort(pool, begin, middle, buffer);
+        merge_sort(pool, middle, end, buffer_middle);
+    }
+    std::merge(begin, middle, middle, end, buffer);
+    std::copy(buffer, buffer + size, begin);
+}
+
+template <typename F>
+static double measure_ms(F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+TEST(ForkJoinPoolTests, FibBenchmark)
+{
+    asio::fork_join_pool pool;
+    uint64_t serial = 0;
+    uint64_t parallel = 0;
+    auto serial_ms = measure_ms([&] { serial = fib_serial(32); });
+    auto parallel_ms = measure_ms([&] { parallel = fib(pool, 32); });
+    EXPECT_EQ(serial, parallel);
+    std::cout << "fib(32) on " << pool.thread_count() << " threads: serial " << serial_ms
+              << " ms, fork/join " << parallel_ms << " ms, speedup " << serial_ms / parallel_ms
+              << std::endl;
+}
+
+TEST(ForkJoinPoolTests, MergeSortBenchmark)
+{
+    asio::fork_join_pool pool;
+    std::vector<int32_t> input(1 << 21);
+    uint32_t seed = 12345;
+    for (auto &value : input)
+    {
+        seed = seed * 1664525 + 1013904223;
+        value = static_cast<int32_t>(seed >> 1);
+    }
+    auto expected = input;
+    std::vector<int32_t> buffer(input.size());
+    auto serial_ms =
+        measure_ms([&] { merge_sort<decltype(input.begin())>(nullptr, expected.begin(),
+                                                               expected.end(), buffer.begin()); });
+    auto parallel_ms = measure_ms(
+        [&] { merge_sort(&pool, input.begin(), input.end(), buffer.begin()); });
+    EXPECT_TRUE(std::is_sorted(input.begin(), input.end()));
+    EXPECT_EQ(input, expected);
+    std::cout << "merge sort of " << input.size() << " ints on " << pool.thread_count()
+              << " threads: serial " << serial_ms << " ms, fork/join " << parallel_ms
+              << " ms, speedup " << serial_ms / parallel_ms << std::endl;
+}
+
+TEST(ForkJoinPoolTests, ExceptionTest)
+{
+    asio::fork_join_pool pool(2);
+    std::atomic<int32_t> executed{0};
+    asio::fork_executor fork(pool);
+    for (int32_t i = 0; i < 100; ++i)
+    {
+        asio::execution::execute(fork, [&executed, i]() {
+            executed++;
+            if (i == 50)
+                throw std::runtime_error("task failed");
+        });
+    }
+    EXPECT_THROW(fork.join(), std::runtime_error);
+    EXPECT_EQ(executed, 100);
+    // the exception is reported once
+    EXPECT_NO_THROW(fork.join());
+
+    // a join_guard waits without throwing, the exception is left for an explicit join
+    executed = 0;
+    {
+        asio::join_guard join(fork);
+        for (int32_t i = 0; i < 100; ++i)
+        {
+            asio::execution::execute(fork, [&executed, i]() {
+                executed++;
+                if (i == 50)
+                    throw std::runtime_error("task failed");
+            });
+        }
+    }
+    EXPECT_EQ(executed, 100);
+    EXPECT_THROW(fork.join(), std::runtime_error);
+
+    // a join_guard destroyed while an exception unwinds its scope
+    executed = 0;
+    EXPECT_THROW(
+        {
+            asio::join_guard join(fork);
+            for (int32_t i = 0; i < 100; ++i)
+            {
+                asio::execution::execute(fork, [&executed]() {
+                    executed++;
+                    throw std::runtime_error("task failed");
+                });
+            }
+            throw std::logic_error("scope failed");
+        },
+        std::logic_error);
+    EXPECT_EQ(executed, 100);
+    EXPECT_THROW(fork.join(), std::runtime_error);
+}
+
+TEST(ForkJoinPoolTests, AdmissionTest)
+{
+    for (auto overflow : {asio::fork_overflow_policy::run_inline, asio::fork_overflow_policy::block})
+    {
+        asio::fork_join_options options;
+        options.max_queued = 64;
+        options.overflow = overflow;
+        asio::fork_join_pool pool(2, options);
+        std::atomic<int32_t> executed{0};
+        asio::fork_executor fork(pool);
+        for (int32_t i = 0; i < 10000; ++i)
+            asio::execution::execute(fork, [&executed]() { executed++; });
+        fork.join();
+        EXPECT_EQ(executed, 10000);
+
+        auto stats = pool.stats();
+        EXPECT_EQ(stats.queue_depth, 0u);
+        EXPECT_LE(stats.max_queue_depth, 64u);
+        if (overflow == asio::fork_overflow_policy::run_inline)
+        {
+            EXPECT_GT(stats.inline_executions, 0u);
+            EXPECT_EQ(stats.blocked_forks, 0u);
+        }
+        else
+        {
+            EXPECT_EQ(stats.inline_executions, 0u);
+            EXPECT_GT(stats.blocked_forks, 0u);
+        }
+
+        // recursive forks from pool threads stay bounded too
+        EXPECT_EQ(fib(pool, 27), fib_serial(27));
+        EXPECT_LE(pool.stats().max_queue_depth, 64u + pool.thread_count() + 1);
+    }
+}
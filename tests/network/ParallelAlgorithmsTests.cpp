@@ -0,0 +1,317 @@
+/**************************************************************************
+ * @file: ParallelAlgorithmsTests.cpp
+ * @brief:
+ *
+ * Copyright (c) 2022 O-Net Communications Inc.
+ * All rights reserved.
+ *************************************************************************/
+
+#include <common/ParallelAlgorithms.h>
+#include <common/PointCloud.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef CPPBASE_HAS_PARALLEL_STL
+#include <execution>
+#endif
+
+using namespace cppbase;
+using namespace onet::lidar;
+
+TEST(ParallelAlgorithmsTests, ForTest)
+{
+    asio::fork_join_pool pool(4);
+    std::vector<int> values(100000, 0);
+    EXPECT_TRUE(ParallelFor(pool, size_t(0), values.size(), [&](size_t i) { values[i] += i % 7; }));
+    for (size_t i = 0; i < values.size(); ++i)
+        ASSERT_EQ(values[i], static_cast<int>(i % 7));
+
+    // empty and single element ranges
+    EXPECT_TRUE(ParallelFor(pool, 5, 5, [](int) { FAIL(); }));
+    int count = 0;
+    ParallelFor(pool, 0, 1, [&](int) { ++count; });
+    EXPECT_EQ(count, 1);
+
+    // fixed grain size
+    std::atomic<int> sum{0};
+    ParallelOptions options;
+    options.grain_size = 3;
+    ParallelFor(pool, 0, 1000, [&](int i) { sum += i; }, options);
+    EXPECT_EQ(sum, 999 * 1000 / 2);
+}
+
+TEST(ParallelAlgorithmsTests, ReduceTest)
+{
+    asio::fork_join_pool pool(4);
+    std::vector<uint64_t> values(1000003);
+    std::iota(values.begin(), values.end(), 0);
+    EXPECT_EQ(ParallelReduce(pool, values.begin(), values.end(), uint64_t(0)),
+              std::accumulate(values.begin(), values.end(), uint64_t(0)));
+    EXPECT_EQ(ParallelReduce(pool, values.begin(), values.begin(), uint64_t(42)), 42u);
+
+    auto max = ParallelReduce(
+        pool, values.begin(), values.end(), uint64_t(0),
+        [](uint64_t a, uint64_t b) { return std::max(a, b); },
+        [](uint64_t v) { return v * 3 % 1000; });
+    EXPECT_EQ(max, 999u);
+}
+
+TEST(ParallelAlgorithmsTests, TransformTest)
+{
+    asio::fork_join_pool pool(4);
+    std::vector<int> in(50000);
+    std::iota(in.begin(), in.end(), 0);
+    std::vector<int> out(in.size());
+    auto end = ParallelTransform(pool, in.begin(), in.end(), out.begin(), [](int v) { return v * 2; });
+    EXPECT_EQ(end, out.end());
+    for (size_t i = 0; i < in.size(); ++i)
+        ASSERT_EQ(out[i], in[i] * 2);
+}
+
+TEST(ParallelAlgorithmsTests, SortTest)
+{
+    asio::fork_join_pool pool(4);
+    std::mt19937 random(7);
+    for (size_t size : {0, 1, 100, 4097, 100000, 1000001})
+    {
+        std::vector<int> values(size);
+        for (auto& v : values)
+            v = static_cast<int>(random() % 100000);
+        auto expected = values;
+        std::sort(expected.begin(), expected.end());
+        ParallelSort(pool, values.begin(), values.end());
+        ASSERT_EQ(values, expected) << size;
+    }
+
+    std::vector<int> values(200000);
+    std::iota(values.begin(), values.end(), 0);
+    std::shuffle(values.begin(), values.end(), random);
+    ParallelSort(pool, values.begin(), values.end(), std::greater<>());
+    EXPECT_TRUE(std::is_sorted(values.begin(), values.end(), std::greater<>()));
+}
+
+TEST(ParallelAlgorithmsTests, ScanTest)
+{
+    asio::fork_join_pool pool(4);
+    for (size_t size : {0, 1, 4096, 4097, 100000, 1000003})
+    {
+        std::vector<uint64_t> values(size);
+        std::iota(values.begin(), values.end(), 1);
+        std::vector<uint64_t> expected(size), result(size);
+        std::inclusive_scan(values.begin(), values.end(), expected.begin());
+        auto end = ParallelScan(pool, values.begin(), values.end(), result.begin());
+        EXPECT_EQ(end, result.end());
+        ASSERT_EQ(result, expected) << size;
+    }
+
+    // in place, small blocks
+    std::vector<int> values(1000, 1);
+    ParallelOptions options;
+    options.grain_size = 10;
+    ParallelScan(pool, values.begin(), values.end(), values.begin(), std::plus<>(), options);
+    for (size_t i = 0; i < values.size(); ++i)
+        ASSERT_EQ(values[i], static_cast<int>(i + 1));
+
+    // values that aren't trivially copyable, the block sums must survive the serial pass
+    std::vector<std::string> strings(40, "a");
+    std::vector<std::string> scanned(strings.size());
+    options.grain_size = 4;
+    auto end = ParallelScan(pool, strings.begin(), strings.end(), scanned.begin(), std::plus<>(),
+                            options);
+    EXPECT_EQ(end, scanned.end());
+    for (size_t i = 0; i < scanned.size(); ++i)
+        ASSERT_EQ(scanned[i], std::string(i + 1, 'a')) << i;
+}
+
+TEST(ParallelAlgorithmsTests, CancellationTest)
+{
+    asio::fork_join_pool pool(4);
+    ParallelOptions options;
+    options.grain_size = 1;
+    options.cancellation = CancellationToken();
+    std::atomic<int> count{0};
+    EXPECT_FALSE(ParallelFor(
+        pool, 0, 1000000,
+        [&](int) {
+            if (++count == 1000)
+                options.cancellation->Cancel();
+        },
+        options));
+    EXPECT_LT(count, 1000000);
+
+    // a cancelled token stops the algorithm before it starts
+    count = 0;
+    EXPECT_FALSE(ParallelFor(pool, 0, 1000, [&](int) { ++count; }, options));
+    EXPECT_EQ(count, 0);
+
+    // a cancelled scan returns the start of the destination range
+    std::vector<int> values(1000, 1), result(values.size());
+    EXPECT_EQ(ParallelScan(pool, values.begin(), values.end(), result.begin(), std::plus<>(),
+                           options),
+              result.begin());
+    // a single block is scanned serially
+    options.grain_size = 0;
+    EXPECT_EQ(ParallelScan(pool, values.begin(), values.end(), result.begin(), std::plus<>(),
+                           options),
+              result.begin());
+
+    // a cancelled transform returns the start of the destination range too
+    auto negate = [](int value) { return -value; };
+    EXPECT_EQ(ParallelTransform(pool, values.begin(), values.end(), result.begin(), negate,
+                                options),
+              result.begin());
+
+    // a sort below the cutoff is sorted serially, either way it reports the cancellation
+    std::vector<int> unsorted(100000);
+    std::iota(unsorted.begin(), unsorted.end(), 0);
+    std::shuffle(unsorted.begin(), unsorted.end(), std::mt19937(1));
+    EXPECT_FALSE(ParallelSort(pool, unsorted.begin(), unsorted.begin() + 1000, std::less<>(),
+                              options));
+    EXPECT_FALSE(ParallelSort(pool, unsorted.begin(), unsorted.end(), std::less<>(), options));
+
+    // cancelled while sorting
+    options.cancellation = CancellationToken();
+    options.grain_size = 1000;
+    count = 0;
+    EXPECT_FALSE(ParallelSort(
+        pool, unsorted.begin(), unsorted.end(),
+        [&](int a, int b) {
+            if (++count == 10000)
+                options.cancellation->Cancel();
+            return a < b;
+        },
+        options));
+    options.cancellation = CancellationToken();
+    EXPECT_TRUE(ParallelSort(pool, unsorted.begin(), unsorted.end(), std::less<>(), options));
+    EXPECT_TRUE(std::is_sorted(unsorted.begin(), unsorted.end()));
+}
+
+TEST(ParallelAlgorithmsTests, ExceptionTest)
+{
+    asio::fork_join_pool pool(4);
+    std::atomic<int> count{0};
+    ParallelOptions options;
+    options.grain_size = 1;
+    EXPECT_THROW(ParallelFor(
+                     pool, 0, 1000000,
+                     [&](int i) {
+                         ++count;
+                         if (i == 500000)
+                             throw std::runtime_error("failed");
+                     },
+                     options),
+                 std::runtime_error);
+    EXPECT_LT(count, 1000000);
+
+    std::vector<int> values(100000);
+    std::iota(values.begin(), values.end(), 0);
+    std::shuffle(values.begin(), values.end(), std::mt19937(1));
+    EXPECT_THROW(ParallelSort(pool, values.begin(), values.end(),
+                              [](int a, int b) {
+                                  if (a == 99999 || b == 99999)
+                                      throw std::logic_error("failed");
+                                  return a < b;
+                              }),
+                 std::logic_error);
+
+    // the pool is still usable
+    EXPECT_TRUE(ParallelFor(pool, 0, 100, [&](int) {}));
+}
+
+template <typename F>
+static double measure_ms(F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// point cloud sized workloads, 50M points only with CPPBASE_BENCHMARK_LARGE set
+TEST(ParallelAlgorithmsTests, PointCloudBenchmark)
+{
+    std::vector<uint32_t> sizes{1000000, 10000000};
+    if (std::getenv("CPPBASE_BENCHMARK_LARGE"))
+        sizes.push_back(50000000);
+
+    asio::fork_join_pool pool;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    for (auto size : sizes)
+    {
+        PointCloud<PointXYZI> cloud(size);
+        for (auto& point : cloud)
+            point = PointXYZI(coordinate(random), coordinate(random), coordinate(random), 1.0f);
+        std::vector<float> ranges(size), serial_ranges(size);
+        auto range = [](const PointXYZI& p) { return p.head<3>().norm(); };
+        auto intensity = [](const PointXYZI& p) { return static_cast<double>(p[3]); };
+
+        std::cout << size << " points (ms)          serial  par_stl  fork_join" << std::endl;
+        double serial = measure_ms([&] {
+            std::transform(cloud.begin(), cloud.end(), serial_ranges.begin(), range);
+        });
+        double par = 0;
+#ifdef CPPBASE_HAS_PARALLEL_STL
+        par = measure_ms([&] {
+            std::transform(std::execution::par, cloud.begin(), cloud.end(), ranges.begin(), range);
+        });
+#endif
+        double fork_join = measure_ms(
+            [&] { ParallelTransform(pool, cloud.begin(), cloud.end(), ranges.begin(), range); });
+        EXPECT_EQ(ranges, serial_ranges);
+        std::cout << "  transform range    " << serial << "  " << par << "  " << fork_join
+                  << std::endl;
+
+        double serial_sum = 0, sum = 0;
+        serial = measure_ms([&] {
+            serial_sum = std::transform_reduce(cloud.begin(), cloud.end(), 0.0, std::plus<>(),
+                                               intensity);
+        });
+#ifdef CPPBASE_HAS_PARALLEL_STL
+        par = measure_ms([&] {
+            sum = std::transform_reduce(std::execution::par, cloud.begin(), cloud.end(), 0.0,
+                                        std::plus<>(), intensity);
+        });
+#endif
+        fork_join = measure_ms([&] {
+            sum = ParallelReduce(pool, cloud.begin(), cloud.end(), 0.0, std::plus<>(), intensity);
+        });
+        EXPECT_DOUBLE_EQ(sum, serial_sum);
+        std::cout << "  reduce intensity   " << serial << "  " << par << "  " << fork_join
+                  << std::endl;
+
+        auto sorted = ranges;
+        serial = measure_ms([&] { std::sort(serial_ranges.begin(), serial_ranges.end()); });
+#ifdef CPPBASE_HAS_PARALLEL_STL
+        par = measure_ms([&] { std::sort(std::execution::par, ranges.begin(), ranges.end()); });
+#endif
+        fork_join = measure_ms([&] { ParallelSort(pool, sorted.begin(), sorted.end()); });
+        EXPECT_EQ(sorted, serial_ranges);
+        std::cout << "  sort range         " << serial << "  " << par << "  " << fork_join
+                  << std::endl;
+
+        std::vector<uint32_t> counts(size, 1), offsets(size), serial_offsets(size);
+        serial = measure_ms(
+            [&] { std::inclusive_scan(counts.begin(), counts.end(), serial_offsets.begin()); });
+#ifdef CPPBASE_HAS_PARALLEL_STL
+        par = measure_ms([&] {
+            std::inclusive_scan(std::execution::par, counts.begin(), counts.end(), offsets.begin());
+        });
+#endif
+        fork_join = measure_ms(
+            [&] { ParallelScan(pool, counts.begin(), counts.end(), offsets.begin()); });
+        EXPECT_EQ(offsets, serial_offsets);
+        std::cout << "  scan offsets       " << serial << "  " << par << "  " << fork_join
+                  << std::endl;
+    }
+}
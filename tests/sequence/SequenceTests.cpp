@@ -6,13 +6,99 @@
  * All rights reserved.
  *************************************************************************/
 
+#include <common/CowPtr.h>
 #include <gtest/gtest.h>
+#include <sequence/LoopProcessor.h>
 #include <sequence/Sequence.h>
+#include <sequence/SwitchProcessor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <sstream>
+#include <thread>
 
 #include "TestProcessors.h"
 
 using namespace cppbase::sequence;
 
+namespace {
+
+// a point cloud sized payload counting its copies
+struct Payload
+{
+    static std::atomic<int> copies;
+
+    Payload() = default;
+    explicit Payload(size_t size) : points(size) {}
+    Payload(const Payload& other) : points(other.points) { copies++; }
+    Payload(Payload&&) = default;
+    Payload& operator=(const Payload& other)
+    {
+        points = other.points;
+        copies++;
+        return *this;
+    }
+    Payload& operator=(Payload&&) = default;
+    bool operator==(const Payload& other) const { return points == other.points; }
+
+    std::vector<float> points;
+};
+std::atomic<int> Payload::copies{0};
+
+// a chain of processors forwarding the sequence's input0, returns the last one
+template <typename T>
+std::shared_ptr<Processor> AddForwardChain(Sequence& S, uint32_t length,
+                                           std::function<void(T&)> modify = {},
+                                           uint32_t modify_at = 0)
+{
+    S.AddInput("input0", cppbase::Variant::GetType<T>());
+    std::shared_ptr<Processor> prev;
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        auto proc = std::make_shared<ForwardProcessor<T>>(i == modify_at ? modify : nullptr);
+        proc->Initialize();
+        S.AddProcessor(proc);
+        if (prev)
+            S.AddLink(prev.get(), proc.get(), 0, 0);
+        else
+            S.MapProcessorInput(proc->GetId(), 0, 0);
+        prev = proc;
+    }
+    return prev;
+}
+
+// a sleeping processor recording how many of its kind execute at the same time at most
+class ConcurrentSleepProcessor : public SleepProcessor
+{
+public:
+    ConcurrentSleepProcessor(std::chrono::milliseconds duration, std::atomic<int>& active,
+                             std::atomic<int>& max_active)
+      : SleepProcessor(duration), m_active(active), m_max_active(max_active)
+    {}
+
+    ExecutionStatus ExecuteReentrant(const std::vector<cppbase::Variant>& inputs,
+                                     std::vector<cppbase::Variant>& results) override
+    {
+        auto active = ++m_active;
+        auto max_active = m_max_active.load();
+        while (max_active < active && !m_max_active.compare_exchange_weak(max_active, active))
+        {
+        }
+        auto status = SleepProcessor::ExecuteReentrant(inputs, results);
+        --m_active;
+        return status;
+    }
+
+private:
+    std::atomic<int>& m_active;
+    std::atomic<int>& m_max_active;
+};
+
+}  // namespace
+
 TEST(SequenceTests, SequenceExecution)
 {
     std::vector<cppbase::Variant> inputs{1.f, 2.f};
@@ -134,4 +220,1105 @@ TEST(SequenceTests, SequenceExecution)
     EXPECT_EQ(status2.ok_count, 2);
     EXPECT_EQ(status2.ng_count, 0);
     std::cout << "Execution time: " << status2.exec_time_us << " us" << std::endl;
-}
\ No newline at end of file
+}
+TEST(SequenceTests, GraphCache)
+{
+    std::vector<cppbase::Variant> inputs{1.f, 2.f};
+    auto A = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+    A->Initialize();
+    auto B = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::MUL);
+    B->Initialize();
+
+    Sequence S;
+    S.AddProcessor(A);
+    S.AddProcessor(B);
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.MapProcessorInput(A->GetId(), 1, 1);
+    S.MapProcessorInput(B->GetId(), 0, 0);
+    S.MapProcessorInput(B->GetId(), 1, 1);
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    S.AddInput("input1", cppbase::Variant::GetType<float>());
+
+    // B (1.0 * 2.0)
+    S.Execute(inputs);
+    EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), 2.f);
+
+    // A (1.0 + 2.0) ---> B (3.0 * 2.0), the link invalidates the cached graph
+    S.AddLink(A.get(), B.get(), 0, 0);
+    S.Execute(inputs);
+    EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), 6.f);
+
+    // A ---> B ---> C (6.0 - 2.0)
+    auto C = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::SUB);
+    C->Initialize();
+    S.AddProcessor(C);
+    S.AddLink(B.get(), C.get(), 0, 0);
+    S.MapProcessorInput(C->GetId(), 1, 1);
+    S.Execute(inputs);
+    EXPECT_EQ(S.GetResults().size(), 3);
+    EXPECT_FLOAT_EQ(C->GetResults()[0].GetValue<float>(), 4.f);
+
+    S.RemoveLink(A->GetId(), B->GetId());
+    S.RemoveProcessor(C->GetId());
+    S.Execute(inputs);
+    EXPECT_EQ(S.GetResults().size(), 2);
+    EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), 2.f);
+    EXPECT_EQ(S.GetExecutionStatus().ok_count, 4);
+
+    // A ---> B and A ---> D, removing the links of A without a destination removes both
+    auto D = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+    D->Initialize();
+    S.AddProcessor(D);
+    S.MapProcessorInput(D->GetId(), 0, 0);
+    S.MapProcessorInput(D->GetId(), 1, 1);
+    S.AddLink(A.get(), B.get(), 0, 0);
+    S.AddLink(A.get(), D.get(), 0, 0);
+    S.Execute(inputs);
+    EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), 6.f);
+    EXPECT_FLOAT_EQ(D->GetResults()[0].GetValue<float>(), 5.f);
+
+    S.RemoveLink(A->GetId());
+    EXPECT_TRUE(S.GetLinks(A.get()).empty());
+    S.Execute(inputs);
+    EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), 2.f);
+    EXPECT_FLOAT_EQ(D->GetResults()[0].GetValue<float>(), 3.f);
+}
+
+TEST(SequenceTests, Compilation)
+{
+    auto make = [](const std::string& name, const std::shared_ptr<Processor>& proc) {
+        proc->Initialize();
+        proc->SetName(name);
+        return proc;
+    };
+    auto names = [](Sequence& S) {
+        try
+        {
+            S.Compile();
+        } catch (const CompileError& e)
+        {
+            return e.GetProcessors();
+        }
+        return std::vector<std::string>{};
+    };
+
+    //       +--> B ---> D
+    // A ----+          ^
+    //       +--> C ----+
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    auto A = make("A", std::make_shared<ForwardProcessor<float>>());
+    auto B = make("B", std::make_shared<ForwardProcessor<float>>());
+    auto C = make("C", std::make_shared<ForwardProcessor<float>>());
+    auto D = make("D", std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD));
+    for (auto& proc : {D, C, B, A})
+        S.AddProcessor(proc);
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.AddLink(A.get(), B.get(), 0, 0);
+    S.AddLink(A.get(), C.get(), 0, 0);
+    S.AddLink(B.get(), D.get(), 0, 0);
+    S.AddLink(C.get(), D.get(), 0, 1);
+    EXPECT_TRUE(names(S).empty());
+    auto levels = S.GetLevels();
+    ASSERT_EQ(levels.size(), 3);
+    EXPECT_EQ(levels[0], std::vector<const Processor*>{A.get()});
+    EXPECT_EQ(levels[1].size(), 2);
+    EXPECT_EQ(levels[2], std::vector<const Processor*>{D.get()});
+    auto order = S.GetExecutionOrder();
+    ASSERT_EQ(order.size(), 4);
+    EXPECT_EQ(order.front(), A.get());
+    EXPECT_EQ(order.back(), D.get());
+    S.Execute({1.f});
+    EXPECT_FLOAT_EQ(D->GetResults()[0].GetValue<float>(), 2.f);
+
+    // B ---> E ---> B, D is downstream of the cycle but not on it
+    auto E = make("E", std::make_shared<ForwardProcessor<float>>());
+    S.AddProcessor(E);
+    S.AddLink(B.get(), E.get(), 0, 0);
+    S.AddLink(E.get(), B.get(), 0, 0);
+    auto cycle = names(S);
+    std::sort(cycle.begin(), cycle.end());
+    EXPECT_EQ(cycle, (std::vector<std::string>{"B", "E"}));
+    EXPECT_THROW(S.Execute({1.f}), CompileError);
+    S.RemoveProcessor(E->GetId());
+    EXPECT_TRUE(names(S).empty());
+
+    // link to an input D doesn't have
+    S.AddLink(A.get(), D.get(), 0, 2);
+    EXPECT_EQ(names(S), (std::vector<std::string>{"A", "D"}));
+    S.RemoveLink(A->GetId(), D->GetId(), 0, 2);
+    EXPECT_TRUE(names(S).empty());
+
+    // link from a float output to an int input
+    auto F = make("F", std::make_shared<ForwardProcessor<int>>());
+    S.AddProcessor(F);
+    S.AddLink(C.get(), F.get(), 0, 0);
+    EXPECT_EQ(names(S), (std::vector<std::string>{"C", "F"}));
+    S.RemoveProcessor(F->GetId());
+
+    // link to a processor of another sequence
+    auto G = make("G", std::make_shared<ForwardProcessor<float>>());
+    S.AddLink(B.get(), G.get(), 0, 0);
+    EXPECT_EQ(names(S), (std::vector<std::string>{"B"}));
+    S.RemoveLink(B->GetId(), G->GetId());
+
+    // sequence input mapped to an input of a different type
+    S.AddInput("input1", cppbase::Variant::GetType<int>());
+    S.MapProcessorInput(D->GetId(), 1, 0);
+    EXPECT_EQ(names(S), (std::vector<std::string>{"D"}));
+}
+
+TEST(SequenceTests, ExecutionBenchmark)
+{
+    for (uint32_t count : {10, 100, 1000})
+    {
+        // a chain of processors adding the sequence's input1 to the previous result
+        Sequence S;
+        S.AddInput("input0", cppbase::Variant::GetType<float>());
+        S.AddInput("input1", cppbase::Variant::GetType<float>());
+        std::shared_ptr<BinaryOpProcessor> prev;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto proc = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+            proc->Initialize();
+            S.AddProcessor(proc);
+            S.MapProcessorInput(proc->GetId(), 1, 1);
+            if (prev)
+                S.AddLink(prev.get(), proc.get(), 0, 0);
+            else
+                S.MapProcessorInput(proc->GetId(), 0, 0);
+            prev = proc;
+        }
+
+        std::vector<cppbase::Variant> inputs{0.f, 1.f};
+        uint32_t executions = 0;
+        cppbase::TimerUs timer;
+        timer.Start();
+        while (executions < 10 || timer.Elapsed() < 200000)
+        {
+            S.Execute(inputs);
+            ++executions;
+        }
+        auto elapsed_us = timer.Elapsed();
+        EXPECT_FLOAT_EQ(prev->GetResults()[0].GetValue<float>(), static_cast<float>(count));
+        EXPECT_EQ(S.GetExecutionStatus().ok_count, executions);
+        std::cout << count << " processors: " << executions * 1e6 / elapsed_us
+                  << " executions/s" << std::endl;
+    }
+}
+
+TEST(SequenceTests, ParallelExecution)
+{
+    /**
+     *                +--> sleep 0 --+
+     * A (1.0 + 2.0) -+--> ...     --+--> ...
+     *                +--> sleep N --+
+     * Every sleeping processor's result goes to the input1 of an adding processor of a chain,
+     * which sums them up.
+     */
+    auto width =
+        std::min<uint32_t>(8, static_cast<uint32_t>(Sequence::GetExecutor().num_workers()));
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    S.AddInput("input1", cppbase::Variant::GetType<float>());
+    auto A = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+    A->Initialize();
+    S.AddProcessor(A);
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.MapProcessorInput(A->GetId(), 1, 1);
+    std::shared_ptr<Processor> sum;
+    for (uint32_t i = 0; i < width; ++i)
+    {
+        auto sleep = std::make_shared<SleepProcessor>(std::chrono::milliseconds(50));
+        sleep->Initialize();
+        S.AddProcessor(sleep);
+        S.AddLink(A.get(), sleep.get(), 0, 0);
+
+        auto add = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+        add->Initialize();
+        S.AddProcessor(add);
+        S.AddLink(sleep.get(), add.get(), 0, 1);
+        if (sum)
+            S.AddLink(sum.get(), add.get(), 0, 0);
+        else
+            S.MapProcessorInput(add->GetId(), 0, 0);
+        sum = add;
+    }
+
+    std::vector<cppbase::Variant> inputs{1.f, 2.f};
+    auto execute = [&] {
+        cppbase::TimerUs timer;
+        timer.Start();
+        auto status = S.Execute(inputs);
+        EXPECT_EQ(status.exec_status, Processor::ExecStatus::PASS);
+        EXPECT_FLOAT_EQ(sum->GetResults()[0].GetValue<float>(), 1.f + 3.f * width);
+        return static_cast<double>(timer.Elapsed());
+    };
+
+    EXPECT_EQ(S.GetConcurrency(), 1);
+    auto serial_us = execute();
+    std::vector<cppbase::Variant> serial_results = S.GetResults();
+
+    S.SetConcurrency(0);
+    auto parallel_us = execute();
+    auto speedup = serial_us / parallel_us;
+    std::cout << width << " branches: serial " << serial_us << " us, parallel " << parallel_us
+              << " us, speedup " << speedup << std::endl;
+    EXPECT_GT(speedup, 0.7 * width);
+
+    // the results are in the order of the processors
+    const auto& results = S.GetResults();
+    ASSERT_EQ(results.size(), serial_results.size());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        EXPECT_EQ(results[i].GetValue<Processor::ExecutionStatus>().id,
+                  serial_results[i].GetValue<Processor::ExecutionStatus>().id);
+        EXPECT_EQ(results[i].GetValue<Processor::ExecutionStatus>().id,
+                  S.GetAllProcessors()[i]->GetId());
+    }
+}
+
+TEST(SequenceTests, NestedExecution)
+{
+    /**
+     * S ---> child ---> grandchild: +--> sleep 0
+     *                               +--> ...
+     *                               +--> sleep N
+     * The sleeping processors of the grandchild are scheduled on the workers of the executor
+     * like the ones of a flat sequence.
+     */
+    auto width =
+        std::min<uint32_t>(8, static_cast<uint32_t>(Sequence::GetExecutor().num_workers()));
+    auto grandchild = std::make_shared<Sequence>();
+    grandchild->AddInput("input0", cppbase::Variant::GetType<float>());
+    std::vector<std::shared_ptr<Processor>> sleeps;
+    for (uint32_t i = 0; i < width; ++i)
+    {
+        auto sleep = std::make_shared<SleepProcessor>(std::chrono::milliseconds(50));
+        sleep->Initialize();
+        grandchild->AddProcessor(sleep);
+        grandchild->MapProcessorInput(sleep->GetId(), 0, 0);
+        sleeps.push_back(sleep);
+    }
+    auto child = std::make_shared<Sequence>();
+    child->AddInput("input0", cppbase::Variant::GetType<float>());
+    child->AddProcessor(grandchild);
+    child->MapProcessorInput(grandchild->GetId(), 0, 0);
+
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    S.AddInput("input1", cppbase::Variant::GetType<float>());
+    auto A = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+    A->Initialize();
+    S.AddProcessor(A);
+    S.AddProcessor(child);
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.MapProcessorInput(A->GetId(), 1, 1);
+    S.AddLink(A.get(), child.get(), 0, 0);
+
+    std::vector<cppbase::Variant> inputs{1.f, 2.f};
+    auto execute = [&] {
+        cppbase::TimerUs timer;
+        timer.Start();
+        auto status = S.Execute(inputs);
+        EXPECT_EQ(status.exec_status, Processor::ExecStatus::PASS);
+        for (auto& sleep : sleeps)
+            EXPECT_FLOAT_EQ(sleep->GetResults()[0].GetValue<float>(), 3.f);
+        EXPECT_EQ(child->GetResults().size(), 1);
+        EXPECT_EQ(grandchild->GetResults().size(), width);
+        return static_cast<double>(timer.Elapsed());
+    };
+
+    auto serial_us = execute();
+    for (auto* seq : {&S, child.get(), grandchild.get()})
+        seq->SetConcurrency(0);
+    auto nested_us = execute();
+    std::cout << width << " nested branches: serial " << serial_us << " us, nested "
+              << nested_us << " us" << std::endl;
+    EXPECT_GT(serial_us / nested_us, 0.7 * width);
+    EXPECT_EQ(grandchild->GetExecutionStatus().ok_count, 2);
+}
+
+TEST(SequenceTests, NestedConcurrency)
+{
+    /**
+     * S: A ---> child: +--> sleep 0 --+--> B
+     *                  +--> sleep 1 --+
+     *                  +--> sleep 2
+     *                  +--> sleep 3
+     * With a concurrency above 1 on both, the child's processors are emplaced into the subflow
+     * of its task in S, where they're limited by the child's concurrency, rather than executed
+     * one after the other by that task.
+     */
+    const int concurrency = 2;
+    std::atomic<int> active{0};
+    std::atomic<int> max_active{0};
+    auto child = std::make_shared<Sequence>();
+    child->AddInput("input0", cppbase::Variant::GetType<float>());
+    std::vector<std::shared_ptr<Processor>> sleeps;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        auto sleep = std::make_shared<ConcurrentSleepProcessor>(std::chrono::milliseconds(20),
+                                                                active, max_active);
+        sleep->Initialize();
+        child->AddProcessor(sleep);
+        child->MapProcessorInput(sleep->GetId(), 0, 0);
+        sleeps.push_back(sleep);
+    }
+    auto B = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::MUL);
+    B->Initialize();
+    child->AddProcessor(B);
+    child->AddLink(sleeps[0].get(), B.get(), 0, 0);
+    child->AddLink(sleeps[1].get(), B.get(), 0, 1);
+
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    S.AddInput("input1", cppbase::Variant::GetType<float>());
+    auto A = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+    A->Initialize();
+    S.AddProcessor(A);
+    S.AddProcessor(child);
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.MapProcessorInput(A->GetId(), 1, 1);
+    S.AddLink(A.get(), child.get(), 0, 0);
+    S.SetConcurrency(concurrency);
+    child->SetConcurrency(concurrency);
+
+    for (float input : {1.f, 2.f, 3.f})
+    {
+        max_active = 0;
+        auto status = S.Execute({input, 2.f});
+        EXPECT_EQ(status.exec_status, Processor::ExecStatus::PASS);
+        for (auto& sleep : sleeps)
+            EXPECT_FLOAT_EQ(sleep->GetResults()[0].GetValue<float>(), input + 2.f);
+        EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), (input + 2.f) * (input + 2.f));
+        ASSERT_EQ(child->GetResults().size(), 5);
+        for (size_t i = 0; i < sleeps.size(); ++i)
+        {
+            EXPECT_EQ(child->GetResults()[i].GetValue<Processor::ExecutionStatus>().id,
+                      sleeps[i]->GetId());
+        }
+        EXPECT_EQ(child->GetExecutionStatus().exec_status, Processor::ExecStatus::PASS);
+        // executed one after the other the sleeps wouldn't overlap
+        EXPECT_EQ(max_active, concurrency);
+    }
+    EXPECT_EQ(child->GetExecutionStatus().ok_count, 3);
+}
+
+TEST(SequenceTests, SharedNestedExecution)
+{
+    /**
+     * S0: A0 ---> child    S1: A1 ---> child
+     * The child is nested in two sequences executed at the same time. A worker joining the
+     * subflow of the child's task in one of them may execute the child's task of the other
+     * meanwhile, which mustn't wait for the first execution of the child.
+     */
+    std::atomic<int> active{0};
+    std::atomic<int> max_active{0};
+    auto child = std::make_shared<Sequence>();
+    child->AddInput("input0", cppbase::Variant::GetType<float>());
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        auto sleep = std::make_shared<ConcurrentSleepProcessor>(std::chrono::milliseconds(2),
+                                                                active, max_active);
+        sleep->Initialize();
+        child->AddProcessor(sleep);
+        child->MapProcessorInput(sleep->GetId(), 0, 0);
+    }
+    child->SetConcurrency(2);
+
+    std::vector<std::unique_ptr<Sequence>> parents;
+    for (int i = 0; i < 2; ++i)
+    {
+        auto S = std::make_unique<Sequence>();
+        S->AddInput("input0", cppbase::Variant::GetType<float>());
+        S->AddInput("input1", cppbase::Variant::GetType<float>());
+        auto A = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+        A->Initialize();
+        S->AddProcessor(A);
+        S->AddProcessor(child);
+        S->MapProcessorInput(A->GetId(), 0, 0);
+        S->MapProcessorInput(A->GetId(), 1, 1);
+        S->AddLink(A.get(), child.get(), 0, 0);
+        S->SetConcurrency(2);
+        parents.push_back(std::move(S));
+    }
+
+    const int executions = 20;
+    std::vector<std::thread> threads;
+    std::atomic<int> passed{0};
+    for (auto& S : parents)
+    {
+        threads.emplace_back([&S, &passed]() {
+            for (int i = 0; i < executions; ++i)
+            {
+                auto status = S->Execute({1.f, 2.f});
+                passed += status.exec_status == Processor::ExecStatus::PASS;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(passed, 2 * executions);
+    EXPECT_EQ(child->GetExecutionStatus().ok_count, 2 * executions);
+}
+
+TEST(SequenceTests, ConditionalExecution)
+{
+    /**
+     *                       +--> x2 ---> x3 --+
+     * switch (input0) ------+                 +--> merge
+     *  branch (input1)      +--> x5 ----------+
+     *                                  +--> x7
+     */
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    S.AddInput("input1", cppbase::Variant::GetType<int>());
+    auto sw = std::make_shared<SwitchProcessor>(cppbase::Variant::GetType<float>(), 2);
+    sw->Initialize();
+    S.AddProcessor(sw);
+    S.MapProcessorInput(sw->GetId(), 0, 0);
+    S.MapProcessorInput(sw->GetId(), 1, 1);
+    std::vector<std::shared_ptr<ScaleProcessor>> scales;
+    for (float factor : {2.f, 3.f, 5.f, 7.f})
+    {
+        scales.push_back(std::make_shared<ScaleProcessor>());
+        scales.back()->Initialize(factor);
+        S.AddProcessor(scales.back());
+    }
+    auto merge = std::make_shared<ForwardProcessor<float>>();
+    merge->Initialize();
+    S.AddProcessor(merge);
+    S.AddLink(sw.get(), scales[0].get(), 0, 0);
+    S.AddLink(scales[0].get(), scales[1].get(), 0, 0);
+    S.AddLink(scales[1].get(), merge.get(), 0, 0);
+    S.AddLink(sw.get(), scales[2].get(), 1, 0);
+    S.AddLink(scales[2].get(), merge.get(), 0, 0);
+    S.AddLink(scales[2].get(), scales[3].get(), 0, 0);
+
+    auto executions = [&] {
+        std::vector<uint32_t> counts;
+        for (auto& scale : scales)
+            counts.push_back(scale->GetExecutions());
+        return counts;
+    };
+    auto pruned = [&] {
+        std::vector<const Processor*> procs;
+        for (auto& id : S.GetExecutionStatus().pruned_processors)
+            procs.push_back(S.GetProcessor(id));
+        return procs;
+    };
+
+    for (uint32_t concurrency : {1, 0})
+    {
+        S.SetConcurrency(concurrency);
+        auto before = executions();
+        EXPECT_EQ(S.Execute({1.f, 0}).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_FLOAT_EQ(merge->GetResults()[0].GetValue<float>(), 6.f);
+        EXPECT_EQ(pruned(), (std::vector<const Processor*>{scales[2].get(), scales[3].get()}));
+
+        EXPECT_EQ(S.Execute({1.f, 1}).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_FLOAT_EQ(merge->GetResults()[0].GetValue<float>(), 5.f);
+        EXPECT_FLOAT_EQ(scales[3]->GetResults()[0].GetValue<float>(), 35.f);
+        EXPECT_EQ(pruned(), (std::vector<const Processor*>{scales[0].get(), scales[1].get()}));
+
+        // no branch is taken, the merge is pruned as well
+        EXPECT_EQ(S.Execute({1.f, 2}).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_EQ(pruned().size(), 5);
+        auto statuses = S.GetResults();
+        EXPECT_EQ(statuses.back().GetValue<Processor::ExecutionStatus>().exec_status,
+                  Processor::ExecStatus::SKIPPED);
+
+        // every processor was executed once per taken branch
+        auto after = executions();
+        EXPECT_EQ(after[0] - before[0], 1);
+        EXPECT_EQ(after[1] - before[1], 1);
+        EXPECT_EQ(after[2] - before[2], 1);
+        EXPECT_EQ(after[3] - before[3], 1);
+    }
+
+    // the cached merge isn't reused after the branch changed
+    S.SetCaching(true);
+    S.Execute({1.f, 0});
+    S.Execute({1.f, 1});
+    S.Execute({1.f, 0});
+    EXPECT_FLOAT_EQ(merge->GetResults()[0].GetValue<float>(), 6.f);
+}
+
+TEST(SequenceTests, LoopExecution)
+{
+    // doubles its input until it's at least 100
+    auto loop = std::make_shared<LoopProcessor>();
+    loop->SetMaxIterations(10);
+    loop->AddInput("input0", cppbase::Variant::GetType<float>());
+    loop->AddOutput("output0", cppbase::Variant::GetType<float>());
+    auto scale = std::make_shared<ScaleProcessor>();
+    scale->Initialize(2.f);
+    loop->AddProcessor(scale);
+    loop->MapProcessorInput(scale->GetId(), 0, 0);
+    loop->SetCondition([&scale](uint32_t, std::vector<cppbase::Variant>& inputs) {
+        inputs[0] = scale->GetResults()[0];
+        return inputs[0].GetValue<float>() < 100.f;
+    });
+
+    loop->Execute({1.f});
+    EXPECT_EQ(loop->GetIterations(), 7);
+    EXPECT_FLOAT_EQ(loop->GetResults()[0].GetValue<float>(), 128.f);
+
+    // nested, the iterations run as a condition task cycle in the loop's subflow
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    auto A = std::make_shared<ForwardProcessor<float>>();
+    A->Initialize();
+    auto B = std::make_shared<ForwardProcessor<float>>();
+    B->Initialize();
+    S.AddProcessor(A);
+    S.AddProcessor(loop);
+    S.AddProcessor(B);
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.AddLink(A.get(), loop.get(), 0, 0);
+    S.AddLink(loop.get(), B.get(), 0, 0);
+    for (uint32_t concurrency : {1, 0})
+    {
+        S.SetConcurrency(concurrency);
+        loop->SetConcurrency(concurrency);
+        auto executions = scale->GetExecutions();
+        EXPECT_EQ(S.Execute({3.f}).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_EQ(loop->GetIterations(), 6);
+        EXPECT_EQ(scale->GetExecutions() - executions, 6);
+        EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), 192.f);
+    }
+
+    // bounded by the maximum number of iterations
+    loop->SetMaxIterations(3);
+    S.Execute({3.f});
+    EXPECT_EQ(loop->GetIterations(), 3);
+    EXPECT_FLOAT_EQ(B->GetResults()[0].GetValue<float>(), 24.f);
+}
+
+TEST(SequenceTests, BatchExecution)
+{
+    // (input0 + input1) * input1 ---> scale 3, the scaling processor has no batch execution
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    S.AddInput("input1", cppbase::Variant::GetType<float>());
+    auto A = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+    A->Initialize();
+    auto B = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::MUL);
+    B->Initialize();
+    auto C = std::make_shared<ScaleProcessor>();
+    C->Initialize(3.f);
+    S.AddProcessor(A);
+    S.AddProcessor(B);
+    S.AddProcessor(C);
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.MapProcessorInput(A->GetId(), 1, 1);
+    S.MapProcessorInput(B->GetId(), 1, 1);
+    S.AddLink(A.get(), B.get(), 0, 0);
+    S.AddLink(B.get(), C.get(), 0, 0);
+
+    const size_t batch_size = 1000;
+    std::vector<float> input0(batch_size);
+    for (size_t i = 0; i < batch_size; ++i)
+        input0[i] = static_cast<float>(i);
+    std::vector<BatchColumn::ConstPtr> inputs{
+        std::make_shared<TypedColumn<float>>(input0),
+        std::make_shared<TypedColumn<float>>(std::vector<float>(batch_size, 2.f))};
+    std::vector<BatchColumn::Ptr> outputs;
+    EXPECT_EQ(S.ExecuteBatch(batch_size, inputs, outputs).exec_status,
+              Processor::ExecStatus::PASS);
+    EXPECT_EQ(C->GetExecutions(), batch_size);
+    // per processor a column with its status for every sample
+    std::vector<Processor*> procs{A.get(), B.get(), C.get()};
+    ASSERT_EQ(outputs.size(), procs.size());
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        ASSERT_EQ(outputs[i]->GetSize(), batch_size);
+        auto status = outputs[i]->GetValue(batch_size - 1).GetValue<Processor::ExecutionStatus>();
+        EXPECT_EQ(status.id, procs[i]->GetId());
+        EXPECT_EQ(status.exec_status, Processor::ExecStatus::PASS);
+    }
+
+    auto results = S.GetBatchResults(C->GetId());
+    ASSERT_EQ(results.size(), 1);
+    auto column = std::dynamic_pointer_cast<const TypedColumn<float>>(results[0]);
+    ASSERT_TRUE(column);
+    for (size_t i = 0; i < batch_size; i += 100)
+    {
+        S.Execute({input0[i], 2.f});
+        EXPECT_FLOAT_EQ(column->GetValues()[i], C->GetResults()[0].GetValue<float>());
+        EXPECT_FLOAT_EQ(column->GetValues()[i], (input0[i] + 2.f) * 2.f * 3.f);
+    }
+
+    // the run thread executes the pending triggers in batches
+    const size_t trigger_count = 20;
+    S.SetTriggerQueue(trigger_count);
+    S.SetBatchSize(8);
+    for (size_t i = 0; i < trigger_count; ++i)
+        S.Trigger({static_cast<float>(i), 2.f});
+    S.ResetExecutionStatus();
+    S.SetMode(Processor::Mode::RUN);
+    for (int i = 0; i < 500 && S.GetTriggerLatency().GetCount() < trigger_count; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    S.SetMode(Processor::Mode::PROGRAM);
+    EXPECT_EQ(S.GetTriggerLatency().GetCount(), trigger_count);
+    EXPECT_EQ(S.GetExecutionStatus().exec_count, 3);
+    // the last batch holds the triggers 16 to 19
+    EXPECT_FLOAT_EQ(S.GetBatchResults(C->GetId())[0]->GetValue(3).GetValue<float>(),
+                    (19.f + 2.f) * 2.f * 3.f);
+
+    // a chain of vectorized processors, per sample and in batches
+    Sequence chain;
+    chain.AddInput("input0", cppbase::Variant::GetType<float>());
+    chain.AddInput("input1", cppbase::Variant::GetType<float>());
+    std::shared_ptr<Processor> prev;
+    for (int i = 0; i < 10; ++i)
+    {
+        auto add = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+        add->Initialize();
+        chain.AddProcessor(add);
+        chain.MapProcessorInput(add->GetId(), 1, 1);
+        if (prev)
+            chain.AddLink(prev.get(), add.get(), 0, 0);
+        else
+            chain.MapProcessorInput(add->GetId(), 0, 0);
+        prev = add;
+    }
+    cppbase::TimerUs timer;
+    timer.Start();
+    for (size_t i = 0; i < batch_size; ++i)
+        chain.Execute({input0[i], 2.f});
+    auto sample_us = static_cast<double>(timer.Elapsed());
+    timer.Start();
+    chain.ExecuteBatch(batch_size, inputs, outputs);
+    auto batch_us = static_cast<double>(timer.Elapsed());
+    std::cout << batch_size << " samples of 10 processors: per sample " << sample_us
+              << " us, batch " << batch_us << " us" << std::endl;
+    EXPECT_FLOAT_EQ(chain.GetBatchResults(prev->GetId())[0]->GetValue(999).GetValue<float>(),
+                    prev->GetResults()[0].GetValue<float>());
+    EXPECT_LT(batch_us, sample_us);
+}
+
+TEST(SequenceTests, PipelinedExecution)
+{
+    // sleep 10 ms -> sleep 20 ms -> sleep 10 ms
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    std::vector<std::shared_ptr<Processor>> stages;
+    for (auto ms : {10, 20, 10})
+    {
+        auto sleep = std::make_shared<SleepProcessor>(std::chrono::milliseconds(ms));
+        sleep->Initialize();
+        S.AddProcessor(sleep);
+        if (stages.empty())
+            S.MapProcessorInput(sleep->GetId(), 0, 0);
+        else
+            S.AddLink(stages.back().get(), sleep.get(), 0, 0);
+        stages.push_back(sleep);
+    }
+
+    const int triggers = 20;
+    auto run = [&] {
+        cppbase::TimerUs timer;
+        timer.Start();
+        for (int i = 0; i < triggers; ++i)
+            S.Submit({static_cast<float>(i)});
+        S.WaitForPipeline();
+        return static_cast<double>(timer.Elapsed());
+    };
+
+    auto sequential_us = run();
+    S.SetPipelined(4);
+    EXPECT_EQ(S.GetMaxTokens(), 4u);
+    auto pipelined_us = run();
+    std::cout << triggers << " triggers: sequential " << sequential_us << " us, pipelined "
+              << pipelined_us << " us" << std::endl;
+    // bounded by the 20 ms stage instead of the 40 ms of the sequence
+    EXPECT_LT(pipelined_us, 0.7 * sequential_us);
+
+    auto status = S.GetExecutionStatus();
+    EXPECT_EQ(status.exec_count, 2u * triggers);
+    EXPECT_EQ(status.ok_count, 2u * triggers);
+    // serial stages see the triggers in order, so the last one wins
+    EXPECT_FLOAT_EQ(stages.back()->GetResults()[0].GetValue<float>(), triggers - 1.f);
+
+    // a parallel stage isn't bounded by its own duration anymore
+    auto slow = std::make_shared<SleepProcessor>(std::chrono::milliseconds(40));
+    slow->Initialize();
+    S.AddProcessor(slow);
+    S.AddLink(stages.back().get(), slow.get(), 0, 0);
+    auto last = std::make_shared<SleepProcessor>(std::chrono::milliseconds(1));
+    last->Initialize();
+    S.AddProcessor(last);
+    S.AddLink(slow.get(), last.get(), 0, 0);
+    auto serial_us = run();
+    S.SetStageType(slow->GetId(), Sequence::StageType::PARALLEL);
+    auto parallel_us = run();
+    std::cout << triggers << " triggers: serial stage " << serial_us << " us, parallel stage "
+              << parallel_us << " us" << std::endl;
+    EXPECT_LT(parallel_us, 0.7 * serial_us);
+    EXPECT_FLOAT_EQ(last->GetResults()[0].GetValue<float>(), triggers - 1.f);
+
+    // executions wait for the triggers in flight and submissions for the executions, the
+    // sequence is compiled again by whichever comes first
+    S.ResetExecutionStatus();
+    S.SetStageType(slow->GetId(), Sequence::StageType::SERIAL);
+    std::thread submitter([&S] {
+        for (int i = 0; i < 5; ++i)
+            S.Submit({static_cast<float>(i)});
+    });
+    for (int i = 0; i < 3; ++i)
+        EXPECT_EQ(S.Execute({1.f}).exec_status, Processor::ExecStatus::PASS);
+    submitter.join();
+    S.WaitForPipeline();
+    EXPECT_EQ(S.GetExecutionStatus().trigger_count, 8u);
+    EXPECT_EQ(S.GetExecutionStatus().ok_count, 8u);
+}
+
+TEST(SequenceTests, ResultHandoff)
+{
+    const uint32_t stages = 5;
+    const size_t points = 1000000;
+
+    // Plain payloads are copied by the processors storing their input into their results and
+    // by handing the results out, once each per stage, but not along the links.
+    {
+        Sequence S;
+        auto last = AddForwardChain<Payload>(S, stages);
+        std::vector<cppbase::Variant> inputs{Payload(points)};
+        Payload::copies = 0;
+        EXPECT_EQ(S.Execute(inputs).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_EQ(Payload::copies, 1 + 2 * static_cast<int>(stages));
+    }
+
+    // payloads shared in a CowPtr aren't copied at all
+    using SharedPayload = cppbase::CowPtr<Payload>;
+    {
+        Sequence S;
+        auto last = AddForwardChain<SharedPayload>(S, stages);
+        std::vector<cppbase::Variant> inputs{cppbase::MakeCow<Payload>(points)};
+        const auto* data = inputs[0].GetValue<SharedPayload>()->points.data();
+        Payload::copies = 0;
+        EXPECT_EQ(S.Execute(inputs).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_EQ(Payload::copies, 0);
+        EXPECT_EQ(last->GetResults()[0].GetValue<SharedPayload>()->points.data(), data);
+    }
+
+    // unless a processor modifies them, which copies them once
+    {
+        Sequence S;
+        auto last = AddForwardChain<SharedPayload>(
+            S, stages, [](SharedPayload& payload) { payload.GetMutable().points[0] = 1.f; }, 2);
+        std::vector<cppbase::Variant> inputs{cppbase::MakeCow<Payload>(points)};
+        Payload::copies = 0;
+        EXPECT_EQ(S.Execute(inputs).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_EQ(Payload::copies, 1);
+        EXPECT_FLOAT_EQ(last->GetResults()[0].GetValue<SharedPayload>()->points[0], 1.f);
+        EXPECT_FLOAT_EQ(inputs[0].GetValue<SharedPayload>()->points[0], 0.f);
+    }
+
+    // a result read by two links is copied for one of them only
+    {
+        Sequence S;
+        auto first = AddForwardChain<Payload>(S, 1);
+        auto a = std::make_shared<ForwardProcessor<Payload>>();
+        auto b = std::make_shared<ForwardProcessor<Payload>>();
+        for (auto& proc : {a, b})
+        {
+            proc->Initialize();
+            S.AddProcessor(proc);
+            S.AddLink(first.get(), proc.get(), 0, 0);
+        }
+        std::vector<cppbase::Variant> inputs{Payload(points)};
+        Payload::copies = 0;
+        EXPECT_EQ(S.Execute(inputs).exec_status, Processor::ExecStatus::PASS);
+        EXPECT_EQ(Payload::copies, 1 + 2 * 3 + 1);
+    }
+}
+
+TEST(SequenceTests, CachedExecution)
+{
+    // a chain of 200 processors, each multiplying its input by its parameter
+    const uint32_t length = 200;
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    std::vector<std::shared_ptr<ScaleProcessor>> procs;
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        auto proc = std::make_shared<ScaleProcessor>();
+        proc->Initialize();
+        S.AddProcessor(proc);
+        if (procs.empty())
+            S.MapProcessorInput(proc->GetId(), 0, 0);
+        else
+            S.AddLink(procs.back().get(), proc.get(), 0, 0);
+        procs.push_back(proc);
+    }
+    auto executions = [&] {
+        uint32_t count = 0;
+        for (auto& proc : procs)
+            count += proc->GetExecutions();
+        return count;
+    };
+    auto execute = [&](float input) {
+        EXPECT_EQ(S.Execute({input}).exec_status, Processor::ExecStatus::PASS);
+        return procs.back()->GetResults()[0].GetValue<float>();
+    };
+
+    S.SetCaching(true);
+    EXPECT_FLOAT_EQ(execute(3.f), 3.f);
+    EXPECT_EQ(executions(), length);
+    EXPECT_TRUE(S.GetExecutionStatus().cached_processors.empty());
+
+    // nothing changed
+    EXPECT_FLOAT_EQ(execute(3.f), 3.f);
+    EXPECT_EQ(executions(), length);
+    EXPECT_EQ(S.GetExecutionStatus().cached_processors.size(), length);
+
+    // only the processors from the modified one on are executed
+    S.SetParam(2.f, 150);
+    EXPECT_EQ(procs[150]->GetParam().GetValue<float>(), 2.f);
+    EXPECT_FLOAT_EQ(execute(3.f), 6.f);
+    EXPECT_EQ(executions(), length + 50);
+    const auto& cached = S.GetExecutionStatus().cached_processors;
+    ASSERT_EQ(cached.size(), 150u);
+    EXPECT_EQ(cached.front(), procs[0]->GetId());
+    EXPECT_EQ(cached.back(), procs[149]->GetId());
+
+    // a new sequence input executes everything
+    EXPECT_FLOAT_EQ(execute(4.f), 8.f);
+    EXPECT_EQ(executions(), 2 * length + 50);
+
+    // processors that aren't cacheable, and the ones after them, are always executed
+    procs[190]->SetCacheable(false);
+    EXPECT_FLOAT_EQ(execute(4.f), 8.f);
+    EXPECT_EQ(executions(), 2 * length + 60);
+
+    // without caching, every processor is executed
+    S.SetCaching(false);
+    EXPECT_FLOAT_EQ(execute(4.f), 8.f);
+    EXPECT_EQ(executions(), 3 * length + 60);
+    EXPECT_TRUE(S.GetExecutionStatus().cached_processors.empty());
+
+    // results are moved into the cache and shared from it: a processor reading a cached result
+    // copies it, processors reusing their cached results don't copy anything. The cache entry
+    // of the first processor keeps a copy of the sequence input it's mapped to.
+    const uint32_t stages = 5;
+    Sequence P;
+    AddForwardChain<Payload>(P, stages);
+    P.SetCaching(true);
+    std::vector<cppbase::Variant> inputs{Payload(1000)};
+    Payload::copies = 0;
+    EXPECT_EQ(P.Execute(inputs).exec_status, Processor::ExecStatus::PASS);
+    EXPECT_EQ(Payload::copies, 1 + 2 * static_cast<int>(stages) + static_cast<int>(stages - 1) + 1);
+    Payload::copies = 0;
+    EXPECT_EQ(P.Execute(inputs).exec_status, Processor::ExecStatus::PASS);
+    EXPECT_EQ(P.GetExecutionStatus().cached_processors.size(), stages);
+    EXPECT_EQ(Payload::copies, 0);
+}
+
+TEST(SequenceTests, Profiling)
+{
+    /**
+     *     +--> B (sleep 20 ms) --+
+     * A --+                      +--> D
+     *     +--> C (sleep 5 ms)  --+
+     */
+    Sequence S;
+    S.SetName("Profiled");
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    auto A = std::make_shared<SleepProcessor>(std::chrono::milliseconds(1));
+    auto B = std::make_shared<SleepProcessor>(std::chrono::milliseconds(20));
+    auto C = std::make_shared<SleepProcessor>(std::chrono::milliseconds(5));
+    auto D = std::make_shared<BinaryOpProcessor>(BinaryOpProcessor::Operator::ADD);
+    for (auto proc : std::vector<std::shared_ptr<Processor>>{A, B, C, D})
+    {
+        proc->Initialize();
+        S.AddProcessor(proc);
+    }
+    B->SetName("B \"slow\"");
+    S.MapProcessorInput(A->GetId(), 0, 0);
+    S.AddLink(A.get(), B.get(), 0, 0);
+    S.AddLink(A.get(), C.get(), 0, 0);
+    S.AddLink(B.get(), D.get(), 0, 0);
+    S.AddLink(C.get(), D.get(), 0, 1);
+    S.SetConcurrency(0);
+
+    const int triggers = 10;
+    S.SetProfiling(true);
+    for (int i = 0; i < triggers; ++i)
+        EXPECT_EQ(S.Execute({1.f}).exec_status, Processor::ExecStatus::PASS);
+    S.SetProfiling(false);
+    S.Execute({1.f});
+
+    const auto& profiler = S.GetProfiler();
+    auto records = profiler.GetTriggers();
+    ASSERT_EQ(records.size(), static_cast<size_t>(triggers));
+    for (auto& record : records)
+    {
+        ASSERT_EQ(record.events.size(), 4u);
+        const auto& a = record.events[0];
+        const auto& d = record.events[3];
+        EXPECT_EQ(a.id, A->GetId());
+        EXPECT_LE(record.start_ns, a.ready_ns);
+        EXPECT_LE(a.end_ns, record.events[1].start_ns);
+        // D was ready once the slower one of B and C was done
+        EXPECT_EQ(d.ready_ns, std::max(record.events[1].end_ns, record.events[2].end_ns));
+        EXPECT_GE(d.start_ns, d.ready_ns);
+        EXPECT_LE(d.end_ns, record.end_ns);
+        EXPECT_GE(d.input_copy_ns, 0);
+    }
+
+    auto stats = profiler.GetStatistics(B->GetId());
+    EXPECT_EQ(stats.count, static_cast<uint64_t>(triggers));
+    EXPECT_GE(stats.p50_us, 20000.0);
+    EXPECT_LE(stats.p50_us, stats.p95_us);
+    EXPECT_LE(stats.p95_us, stats.p99_us);
+    EXPECT_LE(stats.p99_us, stats.max_us);
+    EXPECT_LT(profiler.GetStatistics(C->GetId()).p50_us, stats.p50_us);
+    std::cout << "B: p50 " << stats.p50_us << " us, p95 " << stats.p95_us << " us, p99 "
+              << stats.p99_us << " us" << std::endl;
+
+    std::ostringstream trace;
+    profiler.WriteChromeTrace(trace, S.GetName());
+    auto json = trace.str();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(json.find("\"name\":\"Profiled #1\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"B \\\"slow\\\"\""), std::string::npos);
+    EXPECT_NE(json.find("\"queue_wait_us\""), std::string::npos);
+    EXPECT_NE(json.find("\"thread_name\""), std::string::npos);
+
+    auto path = (std::filesystem::temp_directory_path() / "sequence_trace.json").string();
+    EXPECT_TRUE(profiler.ExportChromeTrace(path, S.GetName()));
+    EXPECT_GT(std::filesystem::file_size(path), json.size() / 2);
+    std::filesystem::remove(path);
+}
+
+TEST(SequenceTests, TriggeredExecution)
+{
+    Sequence S;
+    S.AddInput("input0", cppbase::Variant::GetType<float>());
+    auto sleep = std::make_shared<SleepProcessor>(std::chrono::milliseconds(5));
+    sleep->Initialize();
+    S.AddProcessor(sleep);
+    S.MapProcessorInput(sleep->GetId(), 0, 0);
+
+    auto wait_for = [&S](uint64_t count) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (S.GetTriggerLatency().GetCount() < count &&
+               std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return S.GetTriggerLatency().GetCount();
+    };
+
+    // an idle sequence blocks without executing, its cpu time depends on the load of the
+    // machine so it's printed rather than compared
+    S.SetMode(Processor::Mode::RUN);
+    auto cpu_start = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto idle_cpu_ms = 1000.0 * static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    std::cout << "idle: " << idle_cpu_ms << " ms of cpu in 200 ms" << std::endl;
+    EXPECT_EQ(S.GetExecutionStatus().trigger_count, 0u);
+    EXPECT_EQ(S.GetTriggerLatency().GetCount(), 0u);
+
+    // every trigger is executed with its inputs
+    for (int i = 1; i <= 5; ++i)
+    {
+        EXPECT_TRUE(S.Trigger({static_cast<float>(i)}));
+        EXPECT_EQ(wait_for(i), static_cast<uint64_t>(i));
+    }
+    EXPECT_FLOAT_EQ(sleep->GetResults()[0].GetValue<float>(), 5.f);
+    auto latency = S.GetTriggerLatency();
+    EXPECT_GE(latency.GetMin(), 5000.0);
+    EXPECT_GE(latency.GetPercentile(0.5), latency.GetMin());
+    EXPECT_LE(latency.GetPercentile(0.99), latency.GetMax());
+
+    // switching to TEST mode keeps running
+    S.SetMode(Processor::Mode::TEST);
+    S.ResetTriggerLatency();
+
+    // a full queue drops the oldest triggers, the latest one is executed
+    S.SetTriggerQueue(2, Sequence::TriggerPolicy::DROP_OLDEST);
+    for (int i = 0; i < 10; ++i)
+        S.Trigger({static_cast<float>(i)});
+    auto executed = wait_for(10 - S.GetDroppedTriggers());
+    EXPECT_GT(S.GetDroppedTriggers(), 0u);
+    EXPECT_EQ(executed + S.GetDroppedTriggers(), 10u);
+    EXPECT_FLOAT_EQ(sleep->GetResults()[0].GetValue<float>(), 9.f);
+
+    // or coalesces the newest ones
+    S.ResetTriggerLatency();
+    auto dropped = S.GetDroppedTriggers();
+    S.SetTriggerQueue(1, Sequence::TriggerPolicy::COALESCE);
+    for (int i = 0; i < 10; ++i)
+        S.Trigger({static_cast<float>(i)});
+    executed = wait_for(10 - (S.GetDroppedTriggers() - dropped));
+    EXPECT_EQ(executed + S.GetDroppedTriggers() - dropped, 10u);
+    EXPECT_FLOAT_EQ(sleep->GetResults()[0].GetValue<float>(), 9.f);
+
+    // the timer keeps triggering without inputs, the number of ticks in a given time depends
+    // on the load of the machine
+    S.SetMode(Processor::Mode::PROGRAM);
+    S.ResetTriggerLatency();
+    S.SetTriggerInterval(std::chrono::milliseconds(20));
+    S.SetMode(Processor::Mode::RUN);
+    auto ticks = wait_for(1);
+    EXPECT_GE(ticks, 1u);
+    auto more_ticks = wait_for(ticks + 1);
+    S.SetMode(Processor::Mode::PROGRAM);
+    std::cout << "timer: " << ticks << " then " << more_ticks << " ticks of 20 ms" << std::endl;
+    EXPECT_GT(more_ticks, ticks);
+    EXPECT_FLOAT_EQ(sleep->GetResults()[0].GetValue<float>(), 0.f);
+}
+
+TEST(SequenceTests, TopologyBenchmark)
+{
+    // per processor times stay flat with the size of the sequence when lookups are O(1) and
+    // traversals O(degree), they're printed rather than compared since they depend on the load
+    // of the machine
+    for (uint32_t size : {100, 1000, 10000})
+    {
+        Sequence S;
+        S.AddInput("input0", cppbase::Variant::GetType<float>());
+        std::vector<uuids::uuid> ids;
+        Processor* prev = nullptr;
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            auto proc = std::make_shared<ScaleProcessor>();
+            proc->Initialize();
+            S.AddProcessor(proc);
+            if (prev)
+                S.AddLink(prev, proc.get(), 0, 0);
+            else
+                S.MapProcessorInput(proc->GetId(), 0, 0);
+            prev = proc.get();
+            ids.push_back(proc->GetId());
+        }
+
+        cppbase::TimerNs timer;
+        size_t found = 0;
+        for (auto& id : ids)
+            found += S.GetProcessor(id) != nullptr;
+        auto lookup_ns = static_cast<double>(timer.Elapsed()) / size;
+        EXPECT_EQ(found, size);
+
+        timer.Start();
+        size_t links = 0;
+        for (auto& id : ids)
+            links += S.GetSuccessors(id).size() + S.GetPredecessors(id).size();
+        auto traversal_ns = static_cast<double>(timer.Elapsed()) / size;
+        EXPECT_EQ(links, 2u * (size - 1));
+
+        timer.Start();
+        EXPECT_EQ(S.Execute({1.f}).exec_status, Processor::ExecStatus::PASS);
+        auto first_ns = static_cast<double>(timer.Elapsed()) / size;
+        timer.Start();
+        EXPECT_EQ(S.Execute({1.f}).exec_status, Processor::ExecStatus::PASS);
+        auto execute_ns = static_cast<double>(timer.Elapsed()) / size;
+
+        std::cout << size << " processors, per processor: lookup " << lookup_ns
+                  << " ns, successors and predecessors " << traversal_ns
+                  << " ns, first execution " << first_ns << " ns, execution " << execute_ns
+                  << " ns" << std::endl;
+    }
+}
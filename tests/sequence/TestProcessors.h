@@ -11,6 +11,11 @@
 #include <common/Archive.h>
 #include <sequence/Processor.h>
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
 namespace cppbase { namespace sequence {
 
 class BinaryOpProcessor : public Processor
@@ -74,6 +79,57 @@ public:
         return m_exec_status;
     }
 
+    // applies the operator to the contiguous columns of the inputs
+    ExecutionStatus ExecuteBatch(size_t batch_size,
+                                 const std::vector<BatchColumn::ConstPtr>& inputs,
+                                 std::vector<BatchColumn::Ptr>& outputs) override
+    {
+        cppbase::TimerUs timer;
+        timer.Start();
+        ExecutionStatus status;
+        status.id = m_id;
+        if (!GetExecutable())
+        {
+            outputs.clear();
+            return status;
+        }
+        auto input0 = ToTypedColumn<float>(inputs[0]);
+        auto input1 = ToTypedColumn<float>(inputs[1]);
+        auto output = std::make_shared<TypedColumn<float>>(batch_size);
+        const float* a = input0->GetValues().data();
+        const float* b = input1->GetValues().data();
+        float* result = output->GetValues().data();
+        switch (m_op)
+        {
+        case Operator::ADD:
+            for (size_t i = 0; i < batch_size; ++i)
+                result[i] = a[i] + b[i];
+            break;
+        case Operator::SUB:
+            for (size_t i = 0; i < batch_size; ++i)
+                result[i] = a[i] - b[i];
+            break;
+        case Operator::MUL:
+            for (size_t i = 0; i < batch_size; ++i)
+                result[i] = a[i] * b[i];
+            break;
+        case Operator::DIV:
+            for (size_t i = 0; i < batch_size; ++i)
+                result[i] = a[i] / b[i];
+            break;
+        case Operator::MOD:
+            for (size_t i = 0; i < batch_size; ++i)
+                result[i] = std::fmod(a[i], b[i]);
+            break;
+        default:
+            throw std::runtime_error("BinaryOpProcessor: Invalid Operator");
+        }
+        outputs = {output};
+        status.exec_status = ExecStatus::PASS;
+        status.exec_time_us = static_cast<double>(timer.Elapsed());
+        return status;
+    }
+
 private:
     template<typename Archive>
     void save(Archive& ar, const uint32_t) const
@@ -99,6 +155,136 @@ private:
     Operator m_op;
 };
 
+/**
+ * @brief Waits for a while like a processor waiting for a device, then passes its input on
+ */
+class SleepProcessor : public Processor
+{
+public:
+    SleepProcessor() = default;
+    SleepProcessor(std::chrono::milliseconds duration) : m_duration(duration) {}
+    ~SleepProcessor() override = default;
+
+    bool Initialize(const cppbase::Variant& param = {}) override
+    {
+        Processor::Initialize(param);
+        AddInput("input0", cppbase::Variant::GetType<float>());
+        return true;
+    }
+
+    ExecutionStatus Execute(const std::vector<cppbase::Variant>& inputs) override
+    {
+        if (!PreExecute(inputs))
+        {
+            return m_exec_status;
+        }
+        std::this_thread::sleep_for(m_duration);
+        {
+            std::lock_guard<std::mutex> lock(m_results_mutex);
+            m_results = {inputs[0].IsValid() ? inputs[0].GetValue<float>() : 0.f};
+        }
+        PostExecute(m_results);
+
+        return m_exec_status;
+    }
+
+    // sleeping doesn't touch the execution state, so executions may overlap
+    ExecutionStatus ExecuteReentrant(const std::vector<cppbase::Variant>& inputs,
+                                     std::vector<cppbase::Variant>& results) override
+    {
+        cppbase::TimerUs timer;
+        std::this_thread::sleep_for(m_duration);
+        results = {inputs[0].IsValid() ? inputs[0].GetValue<float>() : 0.f};
+        {
+            std::lock_guard<std::mutex> lock(m_results_mutex);
+            m_results = results;
+        }
+        ExecutionStatus status;
+        status.id = m_id;
+        status.exec_status = ExecStatus::PASS;
+        status.exec_time_us = static_cast<double>(timer.Elapsed());
+        return status;
+    }
+
+private:
+    std::chrono::milliseconds m_duration{10};
+};
+
+/**
+ * @brief Multiplies its input by its parameter and counts its executions
+ */
+class ScaleProcessor : public Processor
+{
+public:
+    ScaleProcessor() = default;
+    ~ScaleProcessor() override = default;
+
+    bool Initialize(const cppbase::Variant& param = 1.f) override
+    {
+        Processor::Initialize(param);
+        AddInput("input0", cppbase::Variant::GetType<float>());
+        return true;
+    }
+
+    ExecutionStatus Execute(const std::vector<cppbase::Variant>& inputs) override
+    {
+        if (!PreExecute(inputs))
+        {
+            return m_exec_status;
+        }
+        m_executions++;
+        m_results = {inputs[0].GetValue<float>() * m_param.GetValue<float>()};
+        PostExecute(m_results);
+
+        return m_exec_status;
+    }
+
+    uint32_t GetExecutions() const { return m_executions; }
+
+private:
+    std::atomic<uint32_t> m_executions{0};
+};
+
+/**
+ * @brief Forwards its input to its result, optionally modifying the result
+ */
+template <typename T>
+class ForwardProcessor : public Processor
+{
+public:
+    ForwardProcessor(std::function<void(T&)> modify = {}) : m_modify(std::move(modify)) {}
+    ~ForwardProcessor() override = default;
+
+    bool Initialize(const cppbase::Variant& param = {}) override
+    {
+        Processor::Initialize(param);
+        AddInput("input0", cppbase::Variant::GetType<T>());
+        AddOutput("output0", cppbase::Variant::GetType<T>());
+        return true;
+    }
+
+    ExecutionStatus Execute(const std::vector<cppbase::Variant>& inputs) override
+    {
+        if (!PreExecute(inputs))
+        {
+            return m_exec_status;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_results_mutex);
+            m_results.clear();
+            m_results.push_back(inputs[0]);
+            if (m_modify)
+                m_modify(m_results[0].GetValue<T>());
+        }
+        PostExecute(m_results);
+
+        return m_exec_status;
+    }
+
+private:
+    std::function<void(T&)> m_modify;
+};
+
 }} // namespace cppbase::sequence
 
 REGISTER_TYPE(cppbase::sequence::BinaryOpProcessor)